@@ -65,6 +65,20 @@ namespace PhysicsEngine
 					springs[i]->stiffness(stiffness);
 					springs[i]->damping(damping);
 				}
+
+				// The lightly damped springs keep the top surface oscillating long after it looks still, so let it sleep sooner.
+				Sleep(.01f, .005f);
+			}
+
+			/// <summary>
+			/// <para>Set the sleep and stabilization thresholds of the dynamic surface.</para>
+			///	<para>PxReal threshold : The mass-normalised kinetic energy below which the surface may sleep.</para>
+			///	<para>PxReal stabilization : The mass-normalised kinetic energy below which the surface is damped towards rest.</para>
+			/// </summary>
+			void Sleep(PxReal threshold, PxReal stabilization)
+			{
+				top->SleepThreshold(threshold);
+				top->StabilizationThreshold(stabilization);
 			}
 
 			/// <summary>
@@ -106,6 +120,22 @@ namespace PhysicsEngine
 					springs[i]->stiffness(0.f);
 			}
 
+			/// <summary>
+			/// <para>Get the body of the dynamic surface.</para>
+			/// </summary>
+			PxRigidDynamic* Body()
+			{
+				return top->Get()->isRigidDynamic();
+			}
+
+			/// <summary>
+			/// <para>Get the speed of the dynamic surface, this is high for a short time after the plunger is released.</para>
+			/// </summary>
+			PxReal Speed()
+			{
+				return top->Get()->isRigidDynamic()->getLinearVelocity().magnitude();
+			}
+
 			/// <summary>
 			/// <para>Release the plunger, this should be called after executing <seealso cref="Plunger::Pull"/> to reset stiffness.</para>
 			/// </summary>
@@ -114,6 +144,9 @@ namespace PhysicsEngine
 				// Reset the 4 spring stiffness' back to the default values.
 				for (unsigned int i = 0; i < springs.size(); i++)
 					springs[i]->stiffness(_stiffness);
+
+				// Changing stiffness does not wake the surface, so make sure the springs can push it back up.
+				top->Get()->isRigidDynamic()->wakeUp();
 			}
 
 			~Plunger()
@@ -132,6 +165,7 @@ namespace PhysicsEngine
 		private:
 			Wedge* wedge;
 			RevoluteJoint* joint;
+			PxReal length;
 
 		public:
 			/// <summary>
@@ -147,6 +181,7 @@ namespace PhysicsEngine
 			{
 				// Set the wedge dimensions, these values are tried and tested to provide the best results.
 				PxVec3 wedgeDimensions = PxVec3(.5f, 1.f, .3f);
+				length = wedgeDimensions.y * scale;
 
 				// Initialize the wedge body of the flipper, positioning it so that the thickest part is central to the joint. Also enable CCD on the wedge.
 				wedge = new Wedge(PxTransform(pose.p + Mathv::Multiply(pose.q, PxVec3(0.f, wedgeDimensions.z / 2.f, 0.f)), pose.q), 1.f, wedgeDimensions * scale);
@@ -182,6 +217,30 @@ namespace PhysicsEngine
 				joint->driveVelocity(-joint->driveVelocity());
 			}
 
+			/// <summary>
+			/// <para>Get the body of the wedge.</para>
+			/// </summary>
+			PxRigidDynamic* Body()
+			{
+				return wedge->Get()->isRigidDynamic();
+			}
+
+			/// <summary>
+			/// <para>Get the world position of the flipper's tip, the wedge's origin is at the pivot end.</para>
+			/// </summary>
+			PxVec3 Tip()
+			{
+				return wedge->Get()->isRigidDynamic()->getGlobalPose().transform(PxVec3(0.f, length, 0.f));
+			}
+
+			/// <summary>
+			/// <para>Get the angular speed of the wedge, this is close to zero while the flipper rests against either limit.</para>
+			/// </summary>
+			PxReal AngularSpeed()
+			{
+				return wedge->Get()->isRigidDynamic()->getAngularVelocity().magnitude();
+			}
+
 			/// <summary>
 			/// <para>Set the material properties of the wedge.</para>
 			///	<para>PxMaterial* material : The material properties to be used on the wedge actor.</para>
@@ -211,8 +270,8 @@ namespace PhysicsEngine
 				// Set the CCD flags for the sphere actor.
 				Get()->isRigidBody()->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_CCD, true);
 
-				// Set the filtering parameters for this object to be a PLAYER and interact with HITPOINTS.
-				SetupFiltering(FilterGroup::PLAYER, FilterGroup::HITPOINT);
+				// Set the filtering parameters for this object to be a PLAYER, TableRules decides what it interacts with.
+				SetupFiltering(FilterGroup::PLAYER);
 			}
 	};
 
@@ -242,6 +301,21 @@ namespace PhysicsEngine
 				// Create the SphericalJoint with nullptr as actor 0, creating a static rotation and position for the body to teeter on.
 				_joint = new SphericalJoint(nullptr, pose, _body, PxTransform(Mathv::Multiply(pose.q, PxVec3(0.f, 0.f, scale.x + scale.y))));
 				_joint->SetLimits(PxPi/8, PxPi/8);
+
+				// A capsule hanging from a limited joint keeps wobbling just above the default sleep threshold, so let it settle
+				// sooner. A hit from the ball wakes it again.
+				Sleep(.01f, .005f);
+			}
+
+			/// <summary>
+			/// <para>Set the sleep and stabilization thresholds of the capsule body.</para>
+			///	<para>PxReal threshold : The mass-normalised kinetic energy below which the body may sleep.</para>
+			///	<para>PxReal stabilization : The mass-normalised kinetic energy below which the body is damped towards rest.</para>
+			/// </summary>
+			void Sleep(PxReal threshold, PxReal stabilization)
+			{
+				_body->SleepThreshold(threshold);
+				_body->StabilizationThreshold(stabilization);
 			}
 
 			/// <summary>
@@ -288,8 +362,8 @@ namespace PhysicsEngine
 				shape->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);
 				shape->setFlag(PxShapeFlag::eTRIGGER_SHAPE, true);
 
-				// Setup the filtering for the box to interact with the PLAYER.
-				SetupFiltering(filterGroup, FilterGroup::PLAYER);
+				// Setup the filtering for the box, TableRules has trigger zones report the PLAYER.
+				SetupFiltering(filterGroup);
 			}
 
 			/// <summary>
@@ -1,6 +1,7 @@
 #ifndef complexactors_h
 #define complexactors_h
 
+#include <fstream>
 #include "../PhysicsEngine.h"
 #include "../Extras//Helper.h"
 
@@ -74,61 +75,385 @@ namespace PhysicsEngine
 			}
 	};
 
+	class StaticMesh : public StaticActor
+	{
+		// This class bakes the shapes of a number of static actors into cooked triangle meshes held by a single actor, so that the
+		// broadphase and narrowphase see a handful of shapes rather than one per wall segment. Shapes are grouped by their material,
+		// colour, filter data and visibility, each group becoming one mesh, which keeps every segment's tags intact.
+
+		private:
+			struct Group
+			{
+				PxMaterial* material;
+				PxVec3 color;
+				PxFilterData filter;
+				bool visible;
+				std::vector<PxVec3> verts;
+				std::vector<PxU32> trigs;
+			};
+
+		public:
+			StaticMesh(const std::vector<StaticActor*>& sources)
+				: StaticActor(PxTransform(PxIdentity))
+			{
+				std::vector<Group> groups;
+
+				// Triangulate every source shape in world space into the group matching its tags.
+				for (PxU32 i = 0; i < sources.size(); i++)
+				{
+					PxRigidActor* source = sources[i]->Get()->isRigidActor();
+					std::vector<PxShape*> shapes = sources[i]->GetShapes();
+
+					for (PxU32 j = 0; j < shapes.size(); j++)
+					{
+						PxMaterial* material = 0;
+						shapes[j]->getMaterials(&material, 1);
+						const PxVec3* color = sources[i]->Color(j);
+
+						Group& group = Find(groups, material, color ? *color : default_color, shapes[j]->getSimulationFilterData(),
+							shapes[j]->getFlags() & PxShapeFlag::eVISUALIZATION);
+						Triangulate(shapes[j], PxShapeExt::getGlobalPose(*shapes[j], *source), group.verts, group.trigs);
+					}
+				}
+
+#if PX_PHYSICS_VERSION_MAJOR > 3 || (PX_PHYSICS_VERSION_MAJOR == 3 && PX_PHYSICS_VERSION_MINOR >= 4)
+				// Cook with the newer BVH midphase where it is available, 3.3 always builds an RTree midphase into the mesh. The cooking
+				// object is shared, so its previous params are put back once the meshes are cooked.
+				const PxCookingParams previous = GetCooking()->getParams();
+				PxCookingParams params = previous;
+				params.midphaseDesc.setToDefault(PxMeshMidPhase::eBVH34);
+				GetCooking()->setParams(params);
+#endif
+
+				// Cook one mesh per group and carry each group's tags over to its shape.
+				for (PxU32 i = 0; i < groups.size(); i++)
+				{
+					PxTriangleMeshDesc mesh_desc;
+					mesh_desc.points.count = (PxU32)groups[i].verts.size();
+					mesh_desc.points.stride = sizeof(PxVec3);
+					mesh_desc.points.data = &groups[i].verts.front();
+					mesh_desc.triangles.count = (PxU32)groups[i].trigs.size() / 3;
+					mesh_desc.triangles.stride = 3 * sizeof(PxU32);
+					mesh_desc.triangles.data = &groups[i].trigs.front();
+
+					CreateShape(PxTriangleMeshGeometry(TriangleMesh::CookMesh(mesh_desc)));
+					Material(groups[i].material, i);
+					Color(groups[i].color, i);
+
+					PxShape* shape = GetShape(i);
+					shape->setSimulationFilterData(groups[i].filter);
+					shape->setQueryFilterData(PxFilterData(groups[i].filter.word0, 0, 0, 0));
+					shape->setFlag(PxShapeFlag::eVISUALIZATION, groups[i].visible);
+				}
+
+#if PX_PHYSICS_VERSION_MAJOR > 3 || (PX_PHYSICS_VERSION_MAJOR == 3 && PX_PHYSICS_VERSION_MINOR >= 4)
+				GetCooking()->setParams(previous);
+#endif
+			}
+
+		private:
+			static Group& Find(std::vector<Group>& groups, PxMaterial* material, const PxVec3& color, const PxFilterData& filter, bool visible)
+			{
+				// Return the group with exactly these tags, adding a new one if no shape so far has had them.
+				for (PxU32 i = 0; i < groups.size(); i++)
+				{
+					const Group& g = groups[i];
+					if (g.material == material && g.color == color && g.visible == visible && g.filter.word0 == filter.word0 &&
+						g.filter.word1 == filter.word1 && g.filter.word2 == filter.word2 && g.filter.word3 == filter.word3)
+						return groups[i];
+				}
+
+				Group g;
+				g.material = material;
+				g.color = color;
+				g.filter = filter;
+				g.visible = visible;
+				groups.push_back(g);
+				return groups.back();
+			}
+
+			static void Triangle(std::vector<PxVec3>& verts, std::vector<PxU32>& trigs, PxU32 a, PxU32 b, PxU32 c, const PxVec3& centre)
+			{
+				// Both boxes and convex meshes are convex, so a triangle faces outwards when its normal points away from the centre.
+				PxVec3 normal = (verts[b] - verts[a]).cross(verts[c] - verts[a]);
+				if (normal.dot(verts[a] - centre) < 0.f)
+					std::swap(b, c);
+
+				trigs.push_back(a);
+				trigs.push_back(b);
+				trigs.push_back(c);
+			}
+
+			static void Triangulate(PxShape* shape, const PxTransform& pose, std::vector<PxVec3>& verts, std::vector<PxU32>& trigs)
+			{
+				PxU32 base = (PxU32)verts.size();
+
+				if (shape->getGeometryType() == PxGeometryType::eBOX)
+				{
+					// Corner i takes the positive half extent on each axis whose bit is set, each face is the four corners sharing
+					// one bit, walked around its perimeter.
+					PxBoxGeometry box;
+					shape->getBoxGeometry(box);
+					PxVec3 corners[8];
+					for (PxU32 i = 0; i < 8; i++)
+						corners[i] = PxVec3((i & 1) ? box.halfExtents.x : -box.halfExtents.x, (i & 2) ? box.halfExtents.y : -box.halfExtents.y,
+							(i & 4) ? box.halfExtents.z : -box.halfExtents.z);
+
+					verts.resize(base + 8);
+					Mathv::Transform(pose, corners, &verts[base], 8);
+
+					const PxU32 perimeter[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+					for (PxU32 axis = 0; axis < 3; axis++)
+					{
+						PxU32 u = 1 << ((axis + 1) % 3), v = 1 << ((axis + 2) % 3);
+						for (PxU32 side = 0; side < 2; side++)
+						{
+							PxU32 q[4];
+							for (PxU32 k = 0; k < 4; k++)
+								q[k] = base + (side << axis) + perimeter[k][0] * u + perimeter[k][1] * v;
+
+							Triangle(verts, trigs, q[0], q[1], q[2], pose.p);
+							Triangle(verts, trigs, q[0], q[2], q[3], pose.p);
+						}
+					}
+				}
+				else if (shape->getGeometryType() == PxGeometryType::eCONVEXMESH)
+				{
+					// Fan each hull polygon out from its first vertex.
+					PxConvexMeshGeometry convex;
+					shape->getConvexMeshGeometry(convex);
+					PxMat33 scale = convex.scale.toMat33();
+
+					const PxVec3* hull = convex.convexMesh->getVertices();
+					PxU32 hull_count = convex.convexMesh->getNbVertices();
+					verts.resize(base + hull_count);
+					for (PxU32 i = 0; i < hull_count; i++)
+						verts[base + i] = scale * hull[i];
+					Mathv::Transform(pose, &verts[base], &verts[base], hull_count);
+
+					PxVec3 centre = pose.transform(scale * convex.convexMesh->getLocalBounds().getCenter());
+					const PxU8* indices = convex.convexMesh->getIndexBuffer();
+					for (PxU32 i = 0; i < convex.convexMesh->getNbPolygons(); i++)
+					{
+						PxHullPolygon polygon;
+						convex.convexMesh->getPolygonData(i, polygon);
+						for (PxU32 k = 1; k + 1 < polygon.mNbVerts; k++)
+							Triangle(verts, trigs, base + indices[polygon.mIndexBase], base + indices[polygon.mIndexBase + k],
+								base + indices[polygon.mIndexBase + k + 1], centre);
+					}
+				}
+				else throw new Exception("StaticMesh::Triangulate, only box and convex mesh shapes can be baked.");
+			}
+	};
+
+	class HeightField : public StaticActor
+	{
+		// This class creates a sculpted surface such as a dimple, ramp or bowl from a grid of heights, using heightfield geometry rather
+		// than many box segments. Rows run along the local x axis and columns along the local z axis, with heights in [0, 1] scaled to
+		// size.y. The grid spans size.x by size.z, with its first sample at the actor's pose.
+
+		public:
+			HeightField(const std::vector<PxReal>& heights, PxU32 rows, PxU32 columns, PxVec3 size, const PxTransform& pose = PxTransform(PxIdentity))
+				: StaticActor(pose)
+			{
+				Create(heights, rows, columns, size);
+			}
+
+			HeightField(const std::string& image, PxVec3 size, const PxTransform& pose = PxTransform(PxIdentity))
+				: StaticActor(pose)
+			{
+				// Build the heights from a greyscale image, one sample per pixel with black the lowest point and white the highest.
+				PxU32 rows, columns;
+				std::vector<PxReal> heights = LoadImage(image, rows, columns);
+				Create(heights, rows, columns, size);
+			}
+
+			static std::vector<PxReal> LoadImage(const std::string& path, PxU32& rows, PxU32& columns)
+			{
+				// Read a binary greyscale PGM (P5) image, with either 8 or 16 bits per pixel, into heights in [0, 1]. Image rows become
+				// heightfield rows.
+				std::ifstream file(path.c_str(), std::ios::binary);
+				std::string magic;
+				PxU32 max_value = 0;
+				file >> magic >> columns >> rows >> max_value;
+				file.get();
+
+				if (!file || magic != "P5" || rows < 2 || columns < 2 || max_value == 0 || max_value > 65535)
+					throw new Exception("HeightField::LoadImage, " + path + " is not a binary greyscale PGM image.");
+
+				PxU32 bytes = (max_value > 255) ? 2 : 1;
+				std::vector<unsigned char> pixels(rows * columns * bytes);
+				if (!file.read((char*)&pixels.front(), pixels.size()))
+					throw new Exception("HeightField::LoadImage, " + path + " is truncated.");
+
+				// 16 bit samples are stored most significant byte first.
+				std::vector<PxReal> heights(rows * columns);
+				for (PxU32 i = 0; i < heights.size(); i++)
+				{
+					PxU32 value = (bytes == 2) ? (pixels[i * 2] << 8) | pixels[i * 2 + 1] : pixels[i];
+					heights[i] = (PxReal)value / (PxReal)max_value;
+				}
+
+				return heights;
+			}
+
+		private:
+			void Create(const std::vector<PxReal>& heights, PxU32 rows, PxU32 columns, PxVec3 size)
+			{
+				if (rows < 2 || columns < 2 || heights.size() < rows * columns)
+					throw new Exception("HeightField::Create, at least a 2 x 2 grid of heights is needed.");
+
+				// Heights are stored as 16 bit integers, so the full range of the samples is used and then scaled back down by the geometry.
+				const PxReal max_height = 32767.f;
+				std::vector<PxHeightFieldSample> samples(rows * columns);
+				for (PxU32 i = 0; i < samples.size(); i++)
+				{
+					samples[i].height = (PxI16)(PxClamp(heights[i], 0.f, 1.f) * max_height);
+					samples[i].materialIndex0 = 0;
+					samples[i].materialIndex1 = 0;
+				}
+
+				PxHeightFieldDesc hf_desc;
+				hf_desc.format = PxHeightFieldFormat::eS16_TM;
+				hf_desc.nbRows = rows;
+				hf_desc.nbColumns = columns;
+				hf_desc.samples.data = &samples.front();
+				hf_desc.samples.stride = sizeof(PxHeightFieldSample);
+
+#if PX_PHYSICS_VERSION_MAJOR > 3 || (PX_PHYSICS_VERSION_MAJOR == 3 && PX_PHYSICS_VERSION_MINOR >= 4)
+				PxHeightField* height_field = GetCooking()->createHeightField(hf_desc, GetPhysics()->getPhysicsInsertionCallback());
+#else
+				PxHeightField* height_field = GetPhysics()->createHeightField(hf_desc);
+#endif
+				if (!height_field)
+					throw new Exception("HeightField::Create, creating the height field failed.");
+
+				CreateShape(PxHeightFieldGeometry(height_field, PxMeshGeometryFlags(), size.y / max_height, size.x / (rows - 1), size.z / (columns - 1)));
+			}
+	};
+
+	struct WallSegment
+	{
+		// One straight box of a wall, as produced by the CurvedWall builders.
+		PxTransform pose;
+		PxBoxGeometry geometry;
+	};
+
 	class CurvedWall : public StaticActor
 	{
 		public:
 			CurvedWall(const PxTransform& pose = PxTransform(PxIdentity), float scale = 1.f, int divisions = 0, float bendFactor = .1f, float height = .1f, float thickness = .05f)
 				: StaticActor(pose)
 			{
-				// The initial size of the walls is 2 ^ divisions + 1, resulting in a recursive split for N walls. e.g. N=1, N=3, N=5, N=9 ...
-				int size = pow(2, divisions) + 1;
+				// The wall is split into 2 ^ divisions segments, e.g. N=1, N=2, N=4, N=8 ... Walls of up to 64 segments are built on the
+				// stack, longer ones need a single temporary buffer.
+				WallSegment local[64];
+				std::vector<WallSegment> buffer;
+				PxU32 count = 1u << divisions;
+				WallSegment* segments = local;
+				if (count > 64)
+				{
+					buffer.resize(count);
+					segments = &buffer.front();
+				}
 
-				// Create a vector to store each 'connecting edge' of the walls, populated with the first top-most and bottom-most elements.
-				PxVec3* points = new PxVec3[size];
-				points[0] = PxVec3(-1, 0, 0) * scale;
-				points[size-1] = PxVec3(1, 0, 0) * scale;
+				Subdivide(scale, divisions, bendFactor, height, thickness, segments, count);
+				Create(segments, count);
+			}
+
+			CurvedWall(const PxTransform& pose, const WallSegment* segments, PxU32 count)
+				: StaticActor(pose)
+			{
+				// Build the wall from segments computed up front, e.g. by Subdivide or Spline.
+				Create(segments, count);
+			}
 
-				// Execute the split recursive function until the wall has been divided enough times.
-				Split(points, 0, size - 1, divisions, PxClamp(bendFactor, .0f, .4f));
+			static PxU32 Subdivide(float scale, int divisions, float bendFactor, float height, float thickness, WallSegment* out, PxU32 capacity)
+			{
+				// Bend a straight wall from (-scale, 0, 0) to (scale, 0, 0) by repeatedly displacing the midpoint of every segment, halving the
+				// bend at each level. Returns the number of segments, which are only written if they all fit within capacity. The points
+				// are held in the output's positions until they are turned into segments, so nothing is allocated.
+				PxU32 count = 1u << divisions;
+				if (count > capacity)
+					return count;
+
+				PxVec3 end = PxVec3(1, 0, 0) * scale;
+				out[0].pose.p = PxVec3(-1, 0, 0) * scale;
+				bendFactor = PxClamp(bendFactor, .0f, .4f);
+
+				for (PxU32 step = count / 2; step > 0; step /= 2, bendFactor /= 2.f)
+				{
+					for (PxU32 a = 0; a < count; a += step * 2)
+					{
+						PxVec3 start = out[a].pose.p;
+						PxVec3 len = ((a + step * 2 < count) ? out[a + step * 2].pose.p : end) - start;
+						out[a + step].pose.p = start + (len / 2.f) + len.cross(PxVec3(0, 0, 1)) * bendFactor;
+					}
+				}
 
-				// Create all of the box geometry using the created points vector.
-				for (int i = 0; i < size - 1; i++)
+				// Each segment's next point is read before the segment overwrites its own position.
+				PxVec3 from = out[0].pose.p;
+				for (PxU32 i = 0; i < count; i++)
 				{
-					// The length is non-deterministic due to the bend factor variable, meaning that each section can vary in length.
-					PxVec3 len = points[i + 1] - points[i];
-					PxVec3 mid = len / 2.f;
+					PxVec3 to = (i + 1 < count) ? out[i + 1].pose.p : end;
+					Segment(from, to, height, thickness, out[i]);
+					from = to;
+				}
 
-					CreateShape(PxBoxGeometry(PxVec3(mid.magnitude(), thickness, height)), 1.f);
-					GetShape(i)->setLocalPose(PxTransform(points[i] + mid, PxQuat(atan2(len.y, len.x), PxVec3(0, 0, 1))));
+				return count;
+			}
+
+			static PxU32 Spline(const PxVec3* controls, PxU32 controlCount, PxU32 segmentsPerSpan, float height, float thickness, WallSegment* out, PxU32 capacity)
+			{
+				// Follow a Catmull-Rom spline through the control points, which lie in the wall's local xy plane, with segmentsPerSpan
+				// segments between each pair of points. Returns the number of segments, which are only written if they all fit.
+				if (controlCount < 2 || segmentsPerSpan == 0)
+					return 0;
+
+				PxU32 count = (controlCount - 1) * segmentsPerSpan;
+				if (count > capacity)
+					return count;
+
+				PxVec3 from = controls[0];
+				for (PxU32 span = 0, i = 0; span < controlCount - 1; span++)
+				{
+					const PxVec3& p0 = controls[span > 0 ? span - 1 : 0];
+					const PxVec3& p1 = controls[span];
+					const PxVec3& p2 = controls[span + 1];
+					const PxVec3& p3 = controls[PxMin(span + 2, controlCount - 1)];
+
+					for (PxU32 k = 1; k <= segmentsPerSpan; k++, i++)
+					{
+						float t = (float)k / segmentsPerSpan, t2 = t * t, t3 = t2 * t;
+						PxVec3 to = (p1 * 2.f + (p2 - p0) * t + (p0 * 2.f - p1 * 5.f + p2 * 4.f - p3) * t2 + (p1 * 3.f - p0 - p2 * 3.f + p3) * t3) * .5f;
+						Segment(from, to, height, thickness, out[i]);
+						from = to;
+					}
 				}
+
+				return count;
 			}
 
 			void SetMaterial(PxMaterial* mat)
 			{
 				// Set the material of all shapes within this object to be equal to the provided physics material.
 				// This sets parameters such as friction and resistution for the overall wall.
-				std::vector<PxShape*> shapes = GetShapes();
-				for (int i = 0; i < shapes.size(); i++)
-					Material(mat, i);
+				Material(mat);
 			}
 		
 		private:
-			void Split(PxVec3*& arr, int indexA, int indexB, int count, float bendFactor)
+			void Create(const WallSegment* segments, PxU32 count)
 			{
-				// This recursive function enables the wall to be split exponentially and quickly using a basic divide and conquer-like algorithm.
-				if (count != 0)
-				{
-					PxVec3 len = arr[indexB] - arr[indexA];
-					PxVec3 mid = arr[indexA] + (len / 2.f);
-
-					int indexNP = (indexA + indexB) / 2;
-					arr[indexNP] = mid + len.cross(PxVec3(0, 0, 1)) * bendFactor;
+				// Every box is created in one pass, reading straight from the segments.
+				CreateShapes(&segments[0].geometry, sizeof(WallSegment), &segments[0].pose, sizeof(WallSegment), count);
+			}
 
-					// Divide the bend factor by 2 to ensure for a coherent and smooth transition across the wall.
-					bendFactor /= 2.f;
-					Split(arr, indexA, indexNP, --count, bendFactor);
-					Split(arr, indexNP, indexB, count, bendFactor);
-				}
+			static void Segment(const PxVec3& from, const PxVec3& to, float height, float thickness, WallSegment& out)
+			{
+				// A box spanning the two points, turned about the z axis to follow the line between them.
+				PxVec3 len = to - from;
+				out.pose = PxTransform(from + (len / 2.f), PxQuat(atan2(len.y, len.x), PxVec3(0, 0, 1)));
+				out.geometry = PxBoxGeometry(PxVec3(len.magnitude() / 2.f, thickness, height));
 			}
 	};
 
@@ -277,6 +602,17 @@ namespace PhysicsEngine
 
 				return PxTransform(_transform.p + Mathv::Multiply(_transform.q, offsetV3.multiply(halfExtents2D)), _transform.q);
 			}
+
+			void RelativeTransforms(const PxVec3* offsets, const PxQuat* rotations, PxTransform* out, PxU32 count)
+			{
+				// RelativeTransform for many placements at once, each offset carries the y offset in z and each result is turned by its
+				// rotation. The placements are built as local transforms and composed with the platform's in one batched call.
+				PxVec3 halfExtents2D = PxVec3(_halfExtents.x, _halfExtents.y, 1.f);
+				for (PxU32 i = 0; i < count; i++)
+					out[i] = PxTransform(offsets[i].multiply(halfExtents2D), rotations[i]);
+
+				Mathv::Multiply(_transform, out, out, count);
+			}
 	};
 
 	class Wedge : public DynamicActor
@@ -57,21 +57,20 @@ namespace PhysicsEngine
 
 			void driveVelocity(PxReal value)
 			{
+				// Nothing changes if the drive is already running at this velocity, so leave any sleeping actors asleep.
+				PxRevoluteJointFlags flags = ((PxRevoluteJoint*)joint)->getRevoluteJointFlags();
+				if ((flags & PxRevoluteJointFlag::eDRIVE_ENABLED) && ((PxRevoluteJoint*)joint)->getDriveVelocity() == value)
+					return;
+
 				// Get both actors within this joint, this will return nullptr if either are null.
-				PxRigidDynamic *actor_0, *actor_1;
-				((PxRevoluteJoint*)joint)->getActors((PxRigidActor*&)actor_0, (PxRigidActor*&)actor_1);
-
-				// If either of the actors are valid and sleeping, wake them up.
-				if (actor_0)
-				{
-					if (actor_0->isSleeping())
-						actor_0->wakeUp();
-				}
-				if (actor_1)
-				{
-					if (actor_1->isSleeping())
-						actor_1->wakeUp();
-				}
+				PxRigidActor *actor_0, *actor_1;
+				((PxRevoluteJoint*)joint)->getActors(actor_0, actor_1);
+
+				// A zero drive only holds the actors still, otherwise wake any dynamic actor which is asleep so it can follow the drive.
+				PxRigidDynamic* dynamics[2] = { actor_0 ? actor_0->isRigidDynamic() : nullptr, actor_1 ? actor_1->isRigidDynamic() : nullptr };
+				for (int i = 0; i < 2; i++)
+					if (value != 0.f && dynamics[i] && dynamics[i]->isSleeping())
+						dynamics[i]->wakeUp();
 
 				// Set the drive velocity for the joint to the provided value and ensure that the joint flag of 'eDRIVE_ENABLED' is set to true.
 				((PxRevoluteJoint*)joint)->setDriveVelocity(value);
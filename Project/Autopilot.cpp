@@ -0,0 +1,261 @@
+#include "Autopilot.h"
+#include <iostream>
+#include <iomanip>
+
+using namespace physx;
+
+static PxReal Arrival(PxReal height, PxReal speed, PxReal accel)
+{
+	// Earliest time at which height + speed t + accel t^2 / 2 falls to zero, or -1 if it never does.
+	if (height <= 0.f)
+		return 0.f;
+
+	if (PxAbs(accel) < 1e-6f)
+		return (speed < 0.f) ? -height / speed : -1.f;
+
+	PxReal disc = speed * speed - 2.f * accel * height;
+	if (disc < 0.f)
+		return -1.f;
+
+	PxReal root = PxSqrt(disc);
+	PxReal t0 = (-speed - root) / accel;
+	PxReal t1 = (-speed + root) / accel;
+	if (t0 > t1)
+		PxSwap(t0, t1);
+
+	return (t0 >= 0.f) ? t0 : t1;
+}
+
+Autopilot::Autopilot(PhysicsEngine::MyScene* scene, const Config& config)
+	: _scene(scene), _config(config), _games(Game::Instance().games())
+{
+	Bind();
+}
+
+void Autopilot::Bind()
+{
+	// Resetting the scene rebuilds the flippers at rest and the plunger released, so start over whenever they change.
+	_bound = _scene->flipperL;
+	_flippers[0].raised = _flippers[1].raised = false;
+	_flippers[0].wait = _flippers[1].wait = 0;
+	_pulling = false;
+	_plungerWait = 0;
+	_radius = _scene->GetBall()->GetShape()->getGeometry().sphere().radius;
+}
+
+PxRigidDynamic* Autopilot::Ball(PxU32 index)
+{
+	// Index 0 is the player's ball, followed by every slot of the multiball pool. Returns null for slots not in play.
+	if (index == 0)
+		return _scene->GetBall()->Get()->isRigidDynamic();
+
+	if (!_scene->multiball->Active(index - 1))
+		return nullptr;
+
+	return _scene->multiball->Get(index - 1)->Get()->isRigidDynamic();
+}
+
+bool Autopilot::Strike(PhysicsEngine::Flipper* flipper, const PxTransform& table, const PxVec3& gravity, PxReal dt)
+{
+	// Everything is worked out in the table's frame, x across the table and y up it. The flipper is treated as the line
+	// from its pivot to its tip, and a ball arrives when its centre comes within its radius of that line.
+	PxVec3 base = table.transformInv(flipper->Body()->getGlobalPose().p);
+	PxVec3 tip = table.transformInv(flipper->Tip());
+
+	PxReal dx = tip.x - base.x;
+	if (PxAbs(dx) < 1e-4f)
+		return false;
+
+	PxReal slope = (tip.y - base.y) / dx;
+	PxReal left = PxMin(base.x, tip.x);
+	PxReal right = PxMax(base.x, tip.x);
+	PxReal minX = left - _radius;
+	PxReal maxX = right + _radius;
+	PxReal lowY = PxMin(base.y, tip.y) - _radius;
+
+	for (PxU32 i = 0; i <= _scene->multiball->Capacity(); i++)
+	{
+		PxRigidDynamic* body = Ball(i);
+		if (!body)
+			continue;
+
+		PxVec3 p = table.transformInv(body->getGlobalPose().p);
+		PxVec3 v = table.rotateInv(body->getLinearVelocity());
+
+		// Balls below the flipper have already been missed.
+		if (p.y < lowY)
+			continue;
+
+		// A ball resting on the flipper is flicked back up the table.
+		PxReal height = p.y - (base.y + slope * (PxClamp(p.x, left, right) - base.x)) - _radius;
+		if (p.x >= minX && p.x <= maxX && height < _radius && v.magnitude() < _config.restSpeed)
+			return true;
+
+		if (v.y >= 0.f)
+			continue;
+
+		// Otherwise follow the ball's parabola down to the line, refining the point along the line it arrives at once.
+		PxReal x = p.x;
+		PxReal t = -1.f;
+		for (int refine = 0; refine < 2; refine++)
+		{
+			t = Arrival(p.y - (base.y + slope * (x - base.x)) - _radius, v.y, gravity.y);
+			if (t < 0.f)
+				break;
+
+			x = p.x + v.x * t + .5f * gravity.x * t * t;
+		}
+
+		// The flip is applied at the start of the next step, so anything arriving within the lead time after it counts.
+		if (t >= 0.f && t <= _config.leadTime + dt && x >= minX && x <= maxX)
+			return true;
+	}
+
+	return false;
+}
+
+bool Autopilot::Waiting(const PxTransform& table)
+{
+	// A ball is waiting to be launched when it rests in the lane just above the plunger's surface.
+	PxVec3 plunger = table.transformInv(_scene->plunger->Body()->getGlobalPose().p);
+
+	for (PxU32 i = 0; i <= _scene->multiball->Capacity(); i++)
+	{
+		PxRigidDynamic* body = Ball(i);
+		if (!body)
+			continue;
+
+		PxVec3 p = table.transformInv(body->getGlobalPose().p);
+		if (PxAbs(p.x - plunger.x) < _config.laneWidth && p.y > plunger.y && p.y - plunger.y < 4.f * _radius &&
+			body->getLinearVelocity().magnitude() < _config.restSpeed)
+			return true;
+	}
+
+	return false;
+}
+
+PxU32 Autopilot::Decide(PxReal dt, InputAction* actions)
+{
+	Stopwatch timer;
+	PxU32 count = 0;
+
+	if (_bound != _scene->flipperL)
+		Bind();
+
+	// Count each game which has finished since the last decision. The game manager restarts games itself, as part of the
+	// step, so the autopilot never changes the game other than through its input.
+	Game& game = Game::Instance();
+	if (game.games() != _games)
+	{
+		_games = game.games();
+		_stats.games++;
+		_stats.lastScore = game.finalScore();
+		_stats.totalScore += _stats.lastScore;
+		_stats.bestScore = PxMax(_stats.bestScore, _stats.lastScore);
+	}
+
+	PxTransform table = _scene->GetPlatform()->RelativeTransform(PxVec2(0.f));
+	PxVec3 gravity = table.rotateInv(_scene->Get()->getGravity());
+
+	// Each flipper is raised when a ball is about to arrive, held for a moment and then dropped.
+	PhysicsEngine::Flipper* flippers[2] = { _scene->flipperL, _scene->flipperR };
+	const InputAction press[2] = { FLIPPER_LEFT_PRESS, FLIPPER_RIGHT_PRESS };
+	const InputAction release[2] = { FLIPPER_LEFT_RELEASE, FLIPPER_RIGHT_RELEASE };
+
+	for (PxU32 f = 0; f < 2; f++)
+	{
+		FlipperState& state = _flippers[f];
+		if (state.wait > 0)
+			state.wait--;
+		else if (state.raised)
+		{
+			actions[count++] = release[f];
+			state.raised = false;
+			state.wait = _config.cooldownSteps;
+		}
+		else if (Strike(flippers[f], table, gravity, dt))
+		{
+			actions[count++] = press[f];
+			state.raised = true;
+			state.wait = _config.holdSteps;
+			_stats.flips++;
+		}
+	}
+
+	// The plunger is pulled once a ball settles on it and released after a while. The pull is varied a little from one
+	// launch to the next, so that consecutive games do not all follow the same path.
+	if (_plungerWait > 0)
+		_plungerWait--;
+	else if (_pulling)
+	{
+		actions[count++] = PLUNGER_RELEASE;
+		_pulling = false;
+		_plungerWait = _config.relaunchSteps;
+		_stats.launches++;
+	}
+	else if (Waiting(table))
+	{
+		actions[count++] = PLUNGER_PULL;
+		_pulling = true;
+		_plungerWait = _config.pullSteps + (_stats.launches % 4) * 5;
+	}
+
+	_stats.steps++;
+	decideTime.Add(timer.Elapsed());
+	return count;
+}
+
+void Autopilot::Step(PxReal dt)
+{
+	InputAction actions[MAX_ACTIONS];
+	PxU32 count = Decide(dt, actions);
+	for (PxU32 i = 0; i < count; i++)
+		_scene->Queue(actions[i]);
+
+	_scene->Update(dt);
+}
+
+namespace Soak
+{
+	void Run(PxU32 games, PxU32 maxSteps, PxU32 multiballCapacity)
+	{
+		const PxReal stepTime = 1.f / 60.f;
+
+		PhysicsEngine::PxInit();
+		Game::Instance().Reset(false);
+
+		PhysicsEngine::MyScene* scene = new PhysicsEngine::MyScene(multiballCapacity);
+		scene->Init();
+
+		// Play with no rendering or frame pacing, reporting each game as it finishes.
+		Autopilot pilot(scene);
+		Stopwatch timer;
+		PxU32 reported = 0;
+
+		while (pilot.stats().games < games && pilot.stats().steps < maxSteps)
+		{
+			pilot.Step(stepTime);
+
+			if (pilot.stats().games != reported)
+			{
+				reported = pilot.stats().games;
+				std::cout << "Game " << reported << ": score " << pilot.stats().lastScore << " at step " << pilot.stats().steps << std::endl;
+			}
+		}
+
+		const Autopilot::Stats& stats = pilot.stats();
+		double seconds = timer.Elapsed() / 1000.0;
+		double simulated = stats.steps * (double)stepTime;
+
+		std::cout << std::fixed << std::setprecision(2);
+		std::cout << stats.games << " games in " << stats.steps << " steps (" << simulated / 3600.0 << "h simulated, " << seconds << "s wall clock)." << std::endl;
+		std::cout << "Games per hour: " << stats.GamesPerHour(stepTime) << " simulated, " << (seconds > 0.0 ? stats.games * 3600.0 / seconds : 0.0) << " wall clock." << std::endl;
+		std::cout << "Score: " << (stats.games ? (double)stats.totalScore / stats.games : 0.0) << " mean, " << stats.bestScore << " best. "
+			<< stats.flips << " flips, " << stats.launches << " launches." << std::endl;
+		std::cout << "Autopilot: " << std::setprecision(4) << pilot.decideTime.Average() * 1000.0 << "us per step, " << pilot.decideTime.Max() * 1000.0 << "us max." << std::endl;
+
+		scene->Release();
+		delete scene;
+		PhysicsEngine::PxRelease();
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef autopilot_h
+#define autopilot_h
+
+#include "MyPhysicsEngine.h"
+#include "Extras/Profiler.h"
+
+/// <summary>
+/// Plays the table without a human, for soak tests and throughput runs. Each step it predicts when every ball in play
+/// will reach each flipper from the ball's pose and velocity, and decides which input actions to apply. Decisions are
+/// plain arithmetic over the balls in play, so deciding never allocates or queries the scene. Games which end are
+/// counted and restarted.
+/// </summary>
+class Autopilot
+{
+	public:
+		struct Config
+		{
+			physx::PxReal leadTime = .06f;			// Seconds before a ball arrives at which to start a flip.
+			physx::PxU32 holdSteps = 12;			// Steps a flipper is held up for.
+			physx::PxU32 cooldownSteps = 6;			// Steps a flipper rests for before it may flip again.
+			physx::PxU32 pullSteps = 45;			// Steps the plunger is held for, varied slightly between launches.
+			physx::PxU32 relaunchSteps = 90;		// Steps to wait after a launch before the plunger may be pulled again.
+			physx::PxReal restSpeed = .3f;			// Balls slower than this (m/s) are resting, e.g. on the plunger.
+			physx::PxReal laneWidth = .25f;			// Half width of the plunger lane either side of the plunger.
+		};
+
+		struct Stats
+		{
+			physx::PxU32 games = 0;
+			physx::PxU32 steps = 0;
+			physx::PxU32 flips = 0;
+			physx::PxU32 launches = 0;
+			long long totalScore = 0;
+			int lastScore = 0;
+			int bestScore = 0;
+
+			// Games completed per hour of simulated play at the given step time.
+			double GamesPerHour(physx::PxReal stepTime) const { return steps ? games * 3600.0 / (steps * (double)stepTime) : 0.0; }
+		};
+
+		// At most one action for each flipper and one for the plunger is decided per step.
+		static const physx::PxU32 MAX_ACTIONS = 3;
+
+	private:
+		// Whether each flipper (left, right) is held up and the steps remaining until it may change again.
+		struct FlipperState
+		{
+			bool raised;
+			physx::PxU32 wait;
+		};
+
+		PhysicsEngine::MyScene* _scene;
+		Config _config;
+		Stats _stats;
+		PhysicsEngine::Flipper* _bound = nullptr;		// Left flipper of the table the state below belongs to.
+		FlipperState _flippers[2];
+		bool _pulling;
+		physx::PxU32 _plungerWait;
+		physx::PxReal _radius;
+		physx::PxU32 _games;							// Games the game manager had finished when last checked.
+
+		void Bind();
+		physx::PxRigidDynamic* Ball(physx::PxU32 index);
+		bool Strike(PhysicsEngine::Flipper* flipper, const physx::PxTransform& table, const physx::PxVec3& gravity, physx::PxReal dt);
+		bool Waiting(const physx::PxTransform& table);
+
+	public:
+		ProfileCounter decideTime;
+
+		Autopilot(PhysicsEngine::MyScene* scene, const Config& config = Config());
+
+		// Decide the input for the next step of dt seconds, writing up to MAX_ACTIONS actions and returning how many. Call
+		// between steps and apply the actions before the step, e.g. with MyScene::Queue.
+		physx::PxU32 Decide(physx::PxReal dt, InputAction* actions);
+
+		// Decide and queue the input for the next step, then take it.
+		void Step(physx::PxReal dt);
+
+		const Stats& stats() const { return _stats; }
+};
+
+namespace Soak
+{
+	// Play games headlessly until the given number have finished or maxSteps have been taken, reporting games per hour.
+	void Run(physx::PxU32 games, physx::PxU32 maxSteps = 0xFFFFFFFF, physx::PxU32 multiballCapacity = 8);
+}
+
+#endif
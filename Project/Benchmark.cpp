@@ -0,0 +1,994 @@
+#include "Benchmark.h"
+#include <cstdlib>
+#include <cctype>
+#include <climits>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include "Extras/Allocations.h"
+#include "Extras/HUD.h"
+
+namespace Benchmark
+{
+	using namespace std;
+
+	const PxReal step_time = 1.f / 60.f;
+	const PxU32 warmup_steps = 30;
+
+	bool HasFlag(const std::vector<std::string>& args, const char* flag)
+	{
+		for (unsigned int i = 0; i < args.size(); i++)
+			if (args[i] == flag)
+				return true;
+		return false;
+	}
+
+	PxU32 Argument(const std::vector<std::string>& args, unsigned int index, PxU32 fallback)
+	{
+		// Numeric positional arguments are optional, anything missing or non-numeric falls back to the default.
+		if (index < args.size() && isdigit((unsigned char)args[index][0]))
+			return (PxU32)strtoul(args[index].c_str(), nullptr, 10);
+		return fallback;
+	}
+
+	bool Run(const std::vector<std::string>& args)
+	{
+		if (args.empty())
+			return false;
+
+		bool render = !HasFlag(args, "-norender");
+		bool known = true;
+
+		// Every benchmark shares one PhysX foundation, created here rather than by each of them.
+		PhysicsEngine::PxInit();
+
+		if (args[0] == "multiball")
+			MultiballScaling(Argument(args, 1, 5000), Argument(args, 2, 120), render);
+		else if (args[0] == "broadphase")
+			Broadphase(Argument(args, 1, 1000), Argument(args, 2, 300));
+		else if (args[0] == "queries")
+			Queries(Argument(args, 1, 4096), Argument(args, 2, 120));
+		else if (args[0] == "telemetry")
+			TelemetryOverhead(Argument(args, 1, 256), Argument(args, 2, 600));
+		else if (args[0] == "rollback")
+			RollbackCost(Argument(args, 1, 64), Argument(args, 2, 8));
+		else if (args[0] == "substeps")
+			Substepping(Argument(args, 1, 1200));
+		else if (args[0] == "idle")
+			Idle(Argument(args, 1, 20));
+		else if (args[0] == "contacts")
+			ContactReports(Argument(args, 1, 500), Argument(args, 2, 600));
+		else if (args[0] == "ccd")
+			CCDPolicies(Argument(args, 1, 200), Argument(args, 2, 40), Argument(args, 3, 300));
+		else if (args[0] == "baked")
+			StaticBaking(Argument(args, 1, 500), Argument(args, 2, 600));
+		else if (args[0] == "heightfield")
+			HeightFieldBowl(Argument(args, 1, 32), Argument(args, 2, 200), Argument(args, 3, 600), render);
+		else if (args[0] == "mathv")
+			MathKernels(Argument(args, 1, 4096), Argument(args, 2, 1000));
+		else if (args[0] == "suite")
+			Suite(args);
+		else
+			known = false;
+
+		PhysicsEngine::PxRelease();
+		return known;
+	}
+
+	void OpenWindow(const char* name)
+	{
+		// Create a window using the same camera and settings as the visual debugger, without entering the GLUT main loop.
+		VisualDebugger::Renderer::BackgroundColor(PxVec3(150.f / 255.f, 150.f / 255.f, 150.f / 255.f));
+		VisualDebugger::Renderer::SetRenderDetail(40);
+		VisualDebugger::Renderer::InitWindow(name, 800, 800);
+		VisualDebugger::Renderer::Init();
+	}
+
+	double RenderFrame(PhysicsEngine::Scene* scene)
+	{
+		// Render every actor in the scene once and return the time taken, including the buffer swap.
+		Stopwatch timer;
+		VisualDebugger::Renderer::Start(PxVec3(0.f, 11.5f, 11.5f), PxVec3(0.f, -2.f, -4.f).getNormalized());
+
+		std::vector<PxActor*> actors = scene->GetAllActors();
+		if (actors.size())
+			VisualDebugger::Renderer::Render(&actors[0], (PxU32)actors.size());
+
+		VisualDebugger::Renderer::Finish();
+		return timer.Elapsed();
+	}
+
+	PxTransform GridPose(PhysicsEngine::MyScene* scene, PxU32 index)
+	{
+		// Lay balls out in layers of a 12 x 24 grid above the playfield, so that no two balls start out overlapping.
+		const PxU32 columns = 12, rows = 24;
+		PxU32 layer = index / (columns * rows);
+		PxU32 cell = index % (columns * rows);
+
+		PxVec2 offset(-.8f + 1.6f * (cell % columns) / (columns - 1), -.6f + 1.4f * (cell / columns) / (rows - 1));
+		return scene->GetPlatform()->RelativeTransform(offset, -.2f - .3f * layer);
+	}
+
+	void SpawnGrid(PhysicsEngine::MyScene* scene, PxU32 count)
+	{
+		// Replace any balls currently in play with count balls laid out on the grid.
+		scene->multiball->RecycleAll();
+		for (PxU32 b = 0; b < count; b++)
+			scene->multiball->Spawn(GridPose(scene, b));
+	}
+
+	void AutoPlay(PhysicsEngine::MyScene* scene, PxU32 step)
+	{
+		// A scripted game, a launch every 10 seconds and both flippers twice a second.
+		PxU32 t = step % 600;
+		if (t == 0)
+			scene->Queue(PLUNGER_PULL);
+		else if (t == 60)
+			scene->Queue(PLUNGER_RELEASE);
+
+		if (step % 30 == 0)
+		{
+			scene->Queue((step % 60) ? FLIPPER_LEFT_RELEASE : FLIPPER_LEFT_PRESS);
+			scene->Queue((step % 60) ? FLIPPER_RIGHT_RELEASE : FLIPPER_RIGHT_PRESS);
+		}
+	}
+
+	void Columns(const char* columns)
+	{
+		// The CSV header, every figure after it is written with four decimal places.
+		cout << columns << endl;
+		cout << fixed << setprecision(4);
+	}
+
+	// One measured run on a freshly initialised table, see Measure. Every callback may be left empty.
+	struct Scenario
+	{
+		PxU32 capacity = 0;						// Multiball pool size, balls when 0.
+		PxU32 balls = 0;						// Balls laid out on the grid before the warm up.
+		PxU32 steps = 0;
+		PxU32 warmup = warmup_steps;
+		bool respawn = true;					// Lost balls are respawned rather than recycled, so the ball count stays constant.
+		bool render = false;					// Render each timed step into the benchmark window, see OpenWindow.
+
+		std::function<void(PhysicsEngine::MyScene*)> configure;			// Before Init, e.g. to choose the scene's config.
+		std::function<void(PhysicsEngine::MyScene*)> setup;				// After Init, before the balls are spawned.
+		std::function<void(PhysicsEngine::MyScene*)> start;				// After the warm up, before the first timed step.
+		std::function<void(PhysicsEngine::MyScene*, PxU32)> prepare;	// Before every step, not timed.
+		std::function<void(PhysicsEngine::MyScene*, PxU32)> step;		// The timed step, a plain scene update when empty.
+		std::function<void(PhysicsEngine::MyScene*, PxU32)> measure;	// After each timed step, not timed.
+		std::function<void(PhysicsEngine::MyScene*)> report;			// After the last step, before the scene is released.
+
+		// Filled in by Measure, complete by the time report is called.
+		double init_ms = 0.0;
+		ProfileCounter simulate, rendering;
+		std::vector<double> frames;				// Time of each timed step in milliseconds.
+		double callback_ms = 0.0;				// Contact callback time per timed step, which is spent inside the step.
+		unsigned long long allocations = 0;
+		unsigned long long peakBytes = 0;		// Allocations::PeakBytes once the steps are done, see peakReset.
+		bool peakReset = false;					// Whether the peak covers only this run, rather than the whole process so far.
+	};
+
+	void Measure(Scenario& run)
+	{
+		// The peak is measured from here where the OS allows it, so it covers building the scene as well as the steps.
+		Game::Instance().Reset(false);
+		run.peakReset = Allocations::ResetPeak();
+
+		PhysicsEngine::MyScene* scene = new PhysicsEngine::MyScene(PxMax(run.capacity ? run.capacity : run.balls, 1u));
+		if (run.configure)
+			run.configure(scene);
+
+		Stopwatch init;
+		scene->Init();
+		run.init_ms = init.Elapsed();
+
+		if (run.respawn)
+			scene->multiball->LivesPerBall(INT_MAX);
+		if (run.setup)
+			run.setup(scene);
+		if (run.balls)
+			SpawnGrid(scene, run.balls);
+
+		// Warm up first, so that pools and caches are in place, then time every step. Allocations are counted over the
+		// timed steps. Steps are numbered from the first warm up.
+		PxU32 s = 0;
+		for (; s < run.warmup; s++)
+		{
+			if (run.prepare)
+				run.prepare(scene, s);
+			if (run.step)
+				run.step(scene, s);
+			else scene->Update(step_time);
+		}
+
+		if (run.start)
+			run.start(scene);
+
+		ProfileCounter& callback = scene->Callback()->callbackTime;
+		callback.Reset();
+		run.frames.reserve(run.steps);
+		unsigned long long allocations = Allocations::Count();
+
+		for (PxU32 end = s + run.steps; s < end; s++)
+		{
+			if (run.prepare)
+				run.prepare(scene, s);
+
+			Stopwatch timer;
+			if (run.step)
+				run.step(scene, s);
+			else scene->Update(step_time);
+			double ms = timer.Elapsed();
+
+			// The frame times were reserved up front, so recording them adds nothing to the count.
+			run.simulate.Add(ms);
+			run.frames.push_back(ms);
+
+			if (run.render)
+				run.rendering.Add(RenderFrame(scene));
+			if (run.measure)
+				run.measure(scene, s);
+		}
+
+		run.allocations = Allocations::Count() - allocations;
+		run.peakBytes = Allocations::PeakBytes();
+		run.callback_ms = run.steps ? callback.Total() / run.steps : 0.0;
+
+		if (run.report)
+			run.report(scene);
+
+		scene->Release();
+		delete scene;
+		VisualDebugger::Renderer::ReleaseMeshCache();
+	}
+
+	void MultiballScaling(PxU32 maxBalls, PxU32 steps, bool render)
+	{
+		if (render)
+			OpenWindow("Benchmark - Multiball");
+
+		Columns("balls,active,simulate_ms,callback_ms,render_ms,simulate_max_ms");
+
+		// Step through 1, 2, 5, 10, 20, 50 ... balls until maxBalls is reached.
+		PxU32 scale[3] = { 1, 2, 5 };
+		for (PxU32 decade = 1, i = 0; ; i = (i + 1) % 3)
+		{
+			PxU32 count = PxMin(scale[i] * decade, maxBalls);
+
+			Scenario run;
+			run.balls = count;
+			run.steps = steps;
+			run.render = render;
+			run.report = [&](PhysicsEngine::MyScene* scene) {
+				// Callback time is spent inside fetchResults, so it is removed from the simulate figure.
+				cout << count << "," << scene->multiball->Active() << "," << run.simulate.Average() - run.callback_ms << "," << run.callback_ms << ","
+					<< run.rendering.Average() << "," << run.simulate.Max() << endl;
+			};
+			Measure(run);
+
+			if (count == maxBalls)
+				break;
+			if (i == 2)
+				decade *= 10;
+		}
+	}
+
+	void Broadphase(PxU32 denseBalls, PxU32 steps)
+	{
+		// Each configuration is measured on a freshly initialised scene so that the broadphase type can change.
+		const char* names[] = { "sap", "mbp-4", "mbp-8", "sap-dynamic-none" };
+		PhysicsEngine::SceneConfig configs[] = {
+			PhysicsEngine::SceneConfig(PxBroadPhaseType::eSAP),
+			PhysicsEngine::SceneConfig(PxBroadPhaseType::eMBP, 4),
+			PhysicsEngine::SceneConfig(PxBroadPhaseType::eMBP, 8),
+			PhysicsEngine::SceneConfig(PxBroadPhaseType::eSAP)
+		};
+		configs[3].dynamic_structure = PxPruningStructure::eNONE;
+
+		PxU32 tables[] = { 0, denseBalls };
+
+		Columns("config,balls,simulate_ms,simulate_max_ms,out_of_bounds");
+
+		for (PxU32 t = 0; t < 2; t++)
+		{
+			for (PxU32 c = 0; c < 4; c++)
+			{
+				Scenario run;
+				run.balls = tables[t];
+				run.steps = steps;
+				run.configure = [&](PhysicsEngine::MyScene* scene) { scene->Config(configs[c]); };
+				run.report = [&](PhysicsEngine::MyScene* scene) {
+					cout << names[c] << "," << tables[t] << "," << run.simulate.Average() << "," << run.simulate.Max() << "," << scene->OutOfBoundsCount() << endl;
+				};
+				Measure(run);
+			}
+		}
+	}
+
+	void Queries(PxU32 queries, PxU32 steps)
+	{
+		Columns("threads,raycasts,sweeps,execute_ms,execute_max_ms,blocked");
+
+		PxSphereGeometry ball(.1f);
+		PxU32 threads[] = { 1, 2, 4 };
+
+		for (PxU32 t = 0; t < 3; t++)
+		{
+			PhysicsEngine::BatchQuery* batch = nullptr;
+			PxU32 blocked = 0;
+
+			// Only the batch's execution is timed, the scene update and building the batch happen before it.
+			Scenario run;
+			run.balls = 64;
+			run.steps = steps;
+			run.setup = [&](PhysicsEngine::MyScene* scene) { batch = scene->CreateBatchQuery(queries, queries / 4, 0, 0, threads[t]); };
+			run.prepare = [&](PhysicsEngine::MyScene* scene, PxU32) {
+				scene->Update(step_time);
+
+				// Cast line-of-sight rays from points above the table towards the hitpoints, and sweep a ball-sized
+				// sphere down the table to predict where a ball would first hit.
+				batch->Clear();
+				for (PxU32 q = 0; q < queries; q++)
+				{
+					PxTransform from = GridPose(scene, q % 288);
+					PxVec3 dir = (scene->GetPlatform()->RelativeTransform(PxVec2(0.f, .3f), -.15f).p - from.p).getNormalized();
+					batch->Raycast(from.p, dir, 20.f, FilterGroup::HITPOINT);
+
+					if (q % 4 == 0)
+						batch->Sweep(ball, from, Mathv::Multiply(from.q, PxVec3(0.f, -1.f, 0.f)), 20.f, FilterGroup::HITPOINT);
+				}
+			};
+			run.step = [&](PhysicsEngine::MyScene*, PxU32) { batch->Execute(); };
+			run.measure = [&](PhysicsEngine::MyScene*, PxU32) {
+				for (PxU32 q = 0; q < batch->NbRaycasts(); q++)
+					if (batch->RaycastResult(q).hasBlock && batch->RaycastResult(q).block.shape->getQueryFilterData().word0 == 0)
+						blocked++;
+			};
+			run.report = [&](PhysicsEngine::MyScene*) {
+				cout << threads[t] << "," << batch->NbRaycasts() << "," << batch->NbSweeps() << "," << run.simulate.Average() << "," << run.simulate.Max() << ","
+					<< blocked / PxMax(steps, 1u) << endl;
+				delete batch;
+			};
+			Measure(run);
+		}
+	}
+
+	void TelemetryOverhead(PxU32 balls, PxU32 steps)
+	{
+		const char* path = "telemetry_benchmark.bin";
+
+		Columns("telemetry,balls,simulate_ms,simulate_max_ms,records,dropped");
+
+		// Each mode runs on a freshly initialised scene with the same balls, so the only difference is the writer.
+		double baseline = 0.0, streamed = 0.0;
+		for (PxU32 mode = 0; mode < 2; mode++)
+		{
+			Telemetry::Writer* writer = nullptr;
+
+			Scenario run;
+			run.balls = balls;
+			run.steps = steps;
+			if (mode == 1)
+			{
+				run.setup = [&](PhysicsEngine::MyScene* scene) {
+					writer = new Telemetry::Writer(path, scene->WorldBounds(), balls + 1);
+					scene->telemetry = writer;
+					Game::Instance().telemetry(writer);
+				};
+			}
+			run.report = [&](PhysicsEngine::MyScene*) {
+				PxU64 records = 0, dropped = 0;
+				if (writer)
+				{
+					writer->Close();
+					records = writer->Records();
+					dropped = writer->Dropped();
+					Game::Instance().telemetry(nullptr);
+					delete writer;
+				}
+
+				(mode ? streamed : baseline) = run.simulate.Average();
+				cout << (mode ? "on" : "off") << "," << balls << "," << run.simulate.Average() << "," << run.simulate.Max() << "," << records << "," << dropped << endl;
+			};
+			Measure(run);
+		}
+
+		cout << "overhead: " << setprecision(2) << (baseline > 0.0 ? 100.0 * (streamed - baseline) / baseline : 0.0) << "%" << endl;
+
+		Telemetry::Scan(path);
+	}
+
+	void RollbackCost(PxU32 balls, PxU32 resimulated, PxU32 rounds)
+	{
+		Rollback* rollback = nullptr;
+
+		// Each round plays resimulated steps, then delivers a flipper press for the earliest of them, forcing the whole
+		// window to be resimulated on the timed step. The warm up goes through the rollback too, so it is done in setup.
+		Scenario run;
+		run.balls = balls;
+		run.steps = rounds;
+		run.warmup = 0;
+		run.setup = [&](PhysicsEngine::MyScene* scene) {
+			rollback = new Rollback(scene, resimulated + 2);
+			for (PxU32 s = 0; s < warmup_steps; s++)
+				rollback->Step(step_time);
+		};
+		run.prepare = [&](PhysicsEngine::MyScene* scene, PxU32 r) {
+			for (PxU32 s = 0; s < resimulated; s++)
+				rollback->Step(step_time);
+
+			rollback->Input(scene->StepCount() - resimulated, (r % 2) ? FLIPPER_LEFT_RELEASE : FLIPPER_LEFT_PRESS);
+		};
+		run.step = [&](PhysicsEngine::MyScene*, PxU32) { rollback->Step(step_time); };
+		run.report = [&](PhysicsEngine::MyScene*) {
+			Columns("balls,resimulated,save_ms,load_ms,resimulate_ms,frame_ms,frame_max_ms,within_16ms");
+			cout << balls << "," << rollback->Resimulated() / PxMax(rollback->Rollbacks(), 1u) << "," << rollback->saveTime.Average() << ","
+				<< rollback->loadTime.Average() << "," << rollback->resimulateTime.Average() << "," << run.simulate.Average() << "," << run.simulate.Max() << ","
+				<< (run.simulate.Max() < 16.0 ? "yes" : "no") << endl;
+			delete rollback;
+		};
+		Measure(run);
+	}
+
+	void Substepping(PxU32 steps)
+	{
+		const char* names[] = { "single", "adaptive", "always" };
+		PhysicsEngine::SceneConfig configs[3];
+		configs[0].max_substeps = 1;
+		configs[2].substep_speed = -1.f;
+
+		Columns("substepping,steps,simulate_calls,substepped,simulate_ms,simulate_max_ms,score");
+
+		// The same scripted game for every config, played from the first step with the usual lives.
+		for (PxU32 c = 0; c < 3; c++)
+		{
+			Scenario run;
+			run.steps = steps;
+			run.warmup = 0;
+			run.respawn = false;
+			run.configure = [&](PhysicsEngine::MyScene* scene) { scene->Config(configs[c]); };
+			run.prepare = AutoPlay;
+			run.report = [&](PhysicsEngine::MyScene* scene) {
+				const ProfileCounter& simulate = scene->SimulateTime();
+				cout << names[c] << "," << scene->StepCount() << "," << scene->SimulateCount() << "," << scene->SubsteppedCount() << ","
+					<< simulate.Average() << "," << simulate.Max() << "," << Game::Instance().score() << endl;
+			};
+			Measure(run);
+		}
+	}
+
+	void Idle(PxU32 seconds)
+	{
+		Columns("second,awake_last,awake_max,woken,asleep,simulate_ms");
+
+		// One row per second of an untouched table, so the figures show the table settling and going to sleep.
+		const PxU32 steps_per_second = (PxU32)(1.f / step_time + .5f);
+		PxU32 woken = 0, asleep = 0, awake_max = 0;
+		ProfileCounter simulate;
+
+		Scenario run;
+		run.steps = seconds * steps_per_second;
+		run.warmup = 0;
+		run.respawn = false;
+		run.measure = [&](PhysicsEngine::MyScene* scene, PxU32 s) {
+			simulate.Add(run.frames.back());
+			awake_max = PxMax(awake_max, scene->AwakeCount());
+			if ((s + 1) % steps_per_second)
+				return;
+
+			cout << (s + 1) / steps_per_second << "," << scene->AwakeCount() << "," << awake_max << "," << scene->Callback()->wakeCount - woken << ","
+				<< scene->Callback()->sleepCount - asleep << "," << simulate.Average() << endl;
+
+			woken = scene->Callback()->wakeCount;
+			asleep = scene->Callback()->sleepCount;
+			awake_max = 0;
+			simulate.Reset();
+		};
+		Measure(run);
+	}
+
+	void ContactReports(PxU32 balls, PxU32 steps)
+	{
+		const char* names[] = { "full", "minimal", "minimal-debounce", "threshold-debounce" };
+		ContactReporting modes[] = {
+			ContactReporting(ContactReporting::FULL),
+			ContactReporting(ContactReporting::MINIMAL),
+			ContactReporting(ContactReporting::MINIMAL, 0.f, 6),
+			ContactReporting(ContactReporting::MINIMAL, 2.f, 6)
+		};
+
+		Columns("reporting,balls,callback_ms,callback_max_ms,simulate_ms,contacts,debounced,score");
+
+		for (PxU32 m = 0; m < 4; m++)
+		{
+			PxU32 contacts = 0;
+
+			Scenario run;
+			run.balls = balls;
+			run.steps = steps;
+			run.configure = [&](PhysicsEngine::MyScene* scene) { scene->Reporting(modes[m]); };
+			run.start = [&](PhysicsEngine::MyScene*) { contacts = Game::Instance().eventCount(GameEvent::CONTACT_FOUND); };
+			run.report = [&](PhysicsEngine::MyScene* scene) {
+				// Callback time is spent inside fetchResults, so it is removed from the simulate figure.
+				cout << names[m] << "," << balls << "," << run.callback_ms << "," << scene->Callback()->callbackTime.Max() << "," << run.simulate.Average() - run.callback_ms << ","
+					<< Game::Instance().eventCount(GameEvent::CONTACT_FOUND) - contacts << "," << scene->Callback()->debounced << "," << Game::Instance().score() << endl;
+			};
+			Measure(run);
+		}
+	}
+
+	void CCDPolicies(PxU32 balls, PxU32 speed, PxU32 steps)
+	{
+		const char* names[] = { "none", "always", "adaptive" };
+		PhysicsEngine::CCDPolicy policies[] = {
+			PhysicsEngine::CCDPolicy(PhysicsEngine::CCDPolicy::NONE),
+			PhysicsEngine::CCDPolicy(PhysicsEngine::CCDPolicy::ALWAYS),
+			PhysicsEngine::CCDPolicy(PhysicsEngine::CCDPolicy::ADAPTIVE)
+		};
+
+		Columns("ccd,balls,launch_speed,simulate_ms,simulate_max_ms,swept_bodies,tunnelled,drained,through_flippers");
+
+		for (PxU32 p = 0; p < 3; p++)
+		{
+			PxBounds3 table;
+			PxTransform frame;
+			PxVec3 corner;
+			PxReal blade = 0.f;
+			std::vector<PxI8> sides;
+			PxU32 tunnelled = 0, drained = 0, through = 0;
+
+			// The balls are launched rather than laid out, and measured from the moment they are launched. The flippers
+			// swing as in a scripted game, so balls meet them moving at full speed.
+			Scenario run;
+			run.capacity = balls;
+			run.steps = steps;
+			run.warmup = 0;
+			run.prepare = AutoPlay;
+			run.configure = [&](PhysicsEngine::MyScene* scene) {
+				PhysicsEngine::SceneConfig config;
+				config.ccd = policies[p];
+				config.max_substeps = 1;
+				scene->Config(config);
+			};
+			run.setup = [&](PhysicsEngine::MyScene* scene) {
+				// Anything which ends up outside the table's bounds, other than through the open bottom, went through a wall
+				// or the playfield. In the platform's frame a drained ball is below its bottom edge and between its side walls.
+				table = scene->GetPlatform()->Get()->getWorldBounds();
+				table.fattenFast(.3f);
+				frame = scene->GetPlatform()->RelativeTransform(PxVec2(0.f));
+				corner = frame.transformInv(scene->GetPlatform()->RelativeTransform(PxVec2(1.f, -1.f)).p);
+
+				// A flipper's blade runs along the wedge's y axis and stands blade high on the playfield along its x axis, a
+				// ball within that height counts as level with the blade.
+				PxShape* shape = 0;
+				scene->flipperL->Body()->getShapes(&shape, 1);
+				blade = PxGeometryQuery::getWorldBounds(shape->getGeometry().any(), PxTransform(PxIdentity), 1.f).maximum.x +
+					scene->multiball->Get(0)->GetShape()->getGeometry().sphere().radius;
+				sides.assign(2 * scene->multiball->Capacity(), 0);
+
+				// Every ball is launched in a fixed pseudo-random direction along the playfield, the same for every policy.
+				PxU32 seed = 1;
+				for (PxU32 b = 0; b < balls; b++)
+				{
+					int slot = scene->multiball->Spawn(GridPose(scene, b % 288));
+					if (slot < 0)
+						break;
+
+					seed = seed * 1664525u + 1013904223u;
+					PxReal angle = (seed >> 8) * (PxTwoPi / 16777216.f);
+					PxVec3 dir = Mathv::Multiply(frame.q, PxVec3(PxCos(angle), 0.f, PxSin(angle)));
+					scene->multiball->Get(slot)->Get()->isRigidDynamic()->setLinearVelocity(dir * (PxReal)speed);
+				}
+			};
+			run.measure = [&](PhysicsEngine::MyScene* scene, PxU32) {
+				PhysicsEngine::Flipper* flippers[2] = { scene->flipperL, scene->flipperR };
+				PxTransform poses[2];
+				PxReal lengths[2];
+				for (PxU32 f = 0; f < 2; f++)
+				{
+					poses[f] = flippers[f]->Body()->getGlobalPose();
+					lengths[f] = poses[f].transformInv(flippers[f]->Tip()).y;
+				}
+
+				// Balls which leave are taken out of play so they are only counted once.
+				for (PxU32 b = 0; b < scene->multiball->Capacity(); b++)
+				{
+					if (!scene->multiball->Active(b))
+						continue;
+
+					// A ball level with a flipper's blade whose centre is on the other side of it than a step ago went
+					// through it, whether the ball or the swinging flipper moved too far in one step.
+					PxVec3 position = scene->multiball->Get(b)->Get()->isRigidDynamic()->getGlobalPose().p;
+					for (PxU32 f = 0; f < 2; f++)
+					{
+						PxVec3 local = poses[f].transformInv(position);
+						PxI8 side = (local.y > 0.f && local.y < lengths[f] && PxAbs(local.x) < blade) ? (local.z > 0.f ? 1 : -1) : 0;
+						if (side && sides[2 * b + f] && side != sides[2 * b + f])
+							through++;
+						sides[2 * b + f] = side;
+					}
+
+					if (table.contains(position))
+						continue;
+
+					PxVec3 local = frame.transformInv(position);
+					if (local.y < corner.y && PxAbs(local.x) < corner.x)
+						drained++;
+					else tunnelled++;
+					scene->multiball->Recycle(b);
+					sides[2 * b] = sides[2 * b + 1] = 0;
+				}
+			};
+			run.report = [&](PhysicsEngine::MyScene* scene) {
+				cout << names[p] << "," << balls << "," << speed << "," << run.simulate.Average() << "," << run.simulate.Max() << "," << scene->CCDSweptAverage() << ","
+					<< tunnelled << "," << drained << "," << through << endl;
+			};
+			Measure(run);
+		}
+	}
+
+	void StaticBaking(PxU32 balls, PxU32 steps)
+	{
+		Columns("table,balls,static_shapes,bake_ms,simulate_ms,simulate_max_ms,contact_pairs,touching_pairs");
+
+		for (PxU32 b = 0; b < 2; b++)
+		{
+			PxU32 statics = 0;
+			PxU64 pairs = 0, touching = 0;
+
+			// Baking happens while the actors are created, so the whole of Init is timed for both tables.
+			Scenario run;
+			run.balls = balls;
+			run.steps = steps;
+			run.configure = [&](PhysicsEngine::MyScene* scene) { scene->BakeStatics(b == 1); };
+			run.setup = [&](PhysicsEngine::MyScene* scene) {
+				std::vector<PxActor*> actors(scene->Get()->getNbActors(PxActorTypeFlag::eRIGID_STATIC));
+				if (actors.size())
+					scene->Get()->getActors(PxActorTypeFlag::eRIGID_STATIC, &actors.front(), (PxU32)actors.size());
+				for (PxU32 i = 0; i < actors.size(); i++)
+					statics += actors[i]->isRigidActor()->getNbShapes();
+			};
+			run.measure = [&](PhysicsEngine::MyScene* scene, PxU32) {
+				// Narrowphase pairs are read back from the SDK statistics after every step.
+				PxSimulationStatistics stats;
+				scene->Get()->getSimulationStatistics(stats);
+				pairs += stats.nbDiscreteContactPairsTotal;
+				touching += stats.nbDiscreteContactPairsWithContacts;
+			};
+			run.report = [&](PhysicsEngine::MyScene*) {
+				cout << (b ? "baked" : "walls") << "," << balls << "," << statics << "," << run.init_ms << "," << run.simulate.Average() << "," << run.simulate.Max() << ","
+					<< pairs / PxMax(steps, 1u) << "," << touching / PxMax(steps, 1u) << endl;
+			};
+			Measure(run);
+		}
+	}
+
+	void HeightFieldBowl(PxU32 resolution, PxU32 balls, PxU32 steps, bool render)
+	{
+		if (render)
+			OpenWindow("Benchmark - Height field");
+
+		// A bowl sloping up from the centre to the rim, sitting on the back of the table facing the cover.
+		resolution = PxMax(resolution, 2u);
+		const PxVec3 size(1.6f, .2f, 1.6f);
+		std::vector<PxReal> heights(resolution * resolution);
+		for (PxU32 r = 0; r < resolution; r++)
+		{
+			for (PxU32 c = 0; c < resolution; c++)
+			{
+				PxReal x = (PxReal)r / (resolution - 1) - .5f, z = (PxReal)c / (resolution - 1) - .5f;
+				heights[r * resolution + c] = PxMin(1.f, (x * x + z * z) * 4.f);
+			}
+		}
+
+		Columns("layout,resolution,shapes,balls,simulate_ms,simulate_max_ms,render_ms");
+
+		for (PxU32 l = 0; l < 2; l++)
+		{
+			PhysicsEngine::StaticActor* bowl = nullptr;
+
+			Scenario run;
+			run.balls = balls;
+			run.steps = steps;
+			run.render = render;
+			run.setup = [&](PhysicsEngine::MyScene* scene) {
+				PxTransform pose = Mathv::Multiply(scene->GetPlatform()->RelativeTransform(PxVec2(-.2f, .2f), -.25f), PxQuat(PxHalfPi, PxVec3(1.f, 0.f, 0.f)));
+				if (l == 0)
+					bowl = new PhysicsEngine::HeightField(heights, resolution, resolution, size, pose);
+				else
+				{
+					// One box per cell, as tall as the cell's average height, which is how the bowl would be built without height fields.
+					bowl = new PhysicsEngine::StaticActor(pose);
+					PxReal cell_x = size.x / (resolution - 1), cell_z = size.z / (resolution - 1);
+					for (PxU32 r = 0; r < resolution - 1; r++)
+					{
+						for (PxU32 c = 0; c < resolution - 1; c++)
+						{
+							PxU32 i = r * resolution + c;
+							PxReal h = PxMax(size.y * (heights[i] + heights[i + 1] + heights[i + resolution] + heights[i + resolution + 1]) / 4.f, .01f);
+
+							bowl->CreateShape(PxBoxGeometry(PxVec3(cell_x / 2.f, h / 2.f, cell_z / 2.f)));
+							bowl->GetShape(r * (resolution - 1) + c)->setLocalPose(PxTransform(PxVec3((r + .5f) * cell_x, h / 2.f, (c + .5f) * cell_z)));
+						}
+					}
+				}
+				bowl->Material(MaterialLibrary::Instance().Get("wood"));
+				scene->Add(bowl);
+			};
+			run.report = [&](PhysicsEngine::MyScene*) {
+				cout << (l ? "boxes" : "heightfield") << "," << resolution << "," << bowl->Get()->isRigidActor()->getNbShapes() << "," << balls << ","
+					<< run.simulate.Average() << "," << run.simulate.Max() << "," << run.rendering.Average() << endl;
+			};
+			Measure(run);
+		}
+	}
+
+	void MathKernels(PxU32 count, PxU32 rounds)
+	{
+		// No scene is needed, the kernels are pure maths. Inputs are fixed pseudo-random values so that runs are comparable.
+		count = PxMax(count, 1u);
+		PxU32 seed = 1;
+		std::vector<PxVec3> points(count), scalar_points(count), batch_points(count);
+		std::vector<PxTransform> poses(count), scalar_poses(count), batch_poses(count);
+		std::vector<PxMat44> scalar_matrices(count), batch_matrices(count);
+		for (PxU32 i = 0; i < count; i++)
+		{
+			PxReal v[7];
+			for (PxU32 k = 0; k < 7; k++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				v[k] = (seed >> 8) / 8388608.f - 1.f;
+			}
+			points[i] = PxVec3(v[0], v[1], v[2]);
+			poses[i] = PxTransform(PxVec3(v[4], v[5], v[6]), PxQuat(v[3] * PxPi, PxVec3(v[0], v[1], v[2] + 2.f).getNormalized()));
+		}
+		const PxTransform parent(PxVec3(1.f, 2.f, 3.f), Mathv::EulerToQuat(.3f, -.7f, 1.1f));
+
+		cout << "kernel,count,scalar_ns,batch_ns,speedup,max_error" << endl;
+		cout << fixed << setprecision(4);
+
+		for (PxU32 kernel = 0; kernel < 4; kernel++)
+		{
+			const char* names[] = { "rotate", "transform", "multiply", "matrices" };
+			ProfileCounter scalar, batch;
+
+			for (PxU32 r = 0; r < rounds; r++)
+			{
+				Stopwatch timer;
+				if (kernel == 0)
+					for (PxU32 i = 0; i < count; i++)
+						scalar_points[i] = parent.q.rotate(points[i]);
+				else if (kernel == 1)
+					for (PxU32 i = 0; i < count; i++)
+						scalar_points[i] = parent.transform(points[i]);
+				else if (kernel == 2)
+					for (PxU32 i = 0; i < count; i++)
+						scalar_poses[i] = parent * poses[i];
+				else
+					for (PxU32 i = 0; i < count; i++)
+						scalar_matrices[i] = PxMat44(poses[i]);
+				scalar.Add(timer.Elapsed());
+
+				timer.Start();
+				if (kernel == 0)
+					Mathv::Rotate(parent.q, &points.front(), &batch_points.front(), count);
+				else if (kernel == 1)
+					Mathv::Transform(parent, &points.front(), &batch_points.front(), count);
+				else if (kernel == 2)
+					Mathv::Multiply(parent, &poses.front(), &batch_poses.front(), count);
+				else
+					Mathv::ToMatrices(&poses.front(), &batch_matrices.front(), count);
+				batch.Add(timer.Elapsed());
+			}
+
+			// The largest difference from the scalar result also keeps either loop from being optimised away.
+			PxReal error = 0.f;
+			for (PxU32 i = 0; i < count; i++)
+			{
+				if (kernel < 2)
+					error = PxMax(error, (scalar_points[i] - batch_points[i]).magnitude());
+				else if (kernel == 2)
+					error = PxMax(error, (scalar_poses[i].p - batch_poses[i].p).magnitude());
+				else
+					for (PxU32 c = 0; c < 4; c++)
+						error = PxMax(error, (scalar_matrices[i][c] - batch_matrices[i][c]).magnitude());
+			}
+
+			double scalar_ns = scalar.Average() * 1e6 / count, batch_ns = batch.Average() * 1e6 / count;
+			cout << names[kernel] << "," << count << "," << scalar_ns << "," << batch_ns << "," << (batch_ns > 0.0 ? scalar_ns / batch_ns : 0.0) << ","
+				<< error << endl;
+		}
+	}
+
+	// Per-frame measurements for one scenario of the suite.
+	struct ScenarioResult
+	{
+		std::string name;
+		std::vector<double> frames;				// Wall-clock time of each measured frame in milliseconds.
+		unsigned long long allocations;
+		unsigned long long peakBytes;			// Most memory the process used, see Scenario::peakBytes.
+		bool peakReset;
+
+		double Percentile(double q) const
+		{
+			std::vector<double> sorted(frames);
+			std::sort(sorted.begin(), sorted.end());
+			return sorted.empty() ? 0.0 : sorted[(size_t)(q * (sorted.size() - 1) + .5)];
+		}
+	};
+
+	void AddLanes(PhysicsEngine::MyScene* scene, PxU32 lanes, PxU32 segmentsPerLane)
+	{
+		// Rows of wavy spline walls across the table, built with the wall builder into one reused buffer.
+		const PxU32 controls = 5;
+		PxU32 perSpan = PxMax(segmentsPerLane / (controls - 1), 1u);
+		std::vector<PhysicsEngine::WallSegment> segments((controls - 1) * perSpan);
+
+		for (PxU32 l = 0; l < lanes; l++)
+		{
+			PxVec3 points[controls];
+			for (PxU32 c = 0; c < controls; c++)
+				points[c] = PxVec3(-1.5f + 3.f * c / (controls - 1), (c % 2) ? .15f : -.15f, 0.f);
+
+			PxU32 count = PhysicsEngine::CurvedWall::Spline(points, controls, perSpan, .25f, .02f, &segments.front(), (PxU32)segments.size());
+			PhysicsEngine::CurvedWall* lane = new PhysicsEngine::CurvedWall(scene->GetPlatform()->RelativeTransform(PxVec2(0.f, -.6f + 1.3f * l / PxMax(lanes - 1, 1u))),
+				&segments.front(), count);
+			lane->SetMaterial(MaterialLibrary::Instance().Get("wood"));
+			scene->Add(lane);
+		}
+	}
+
+	void WriteJson(ostream& out, const std::vector<ScenarioResult>& results)
+	{
+		out << fixed << setprecision(4);
+		out << "{" << endl << "  \"scenarios\": [" << endl;
+		for (unsigned int i = 0; i < results.size(); i++)
+		{
+			const ScenarioResult& r = results[i];
+			double total = 0.0;
+			for (unsigned int f = 0; f < r.frames.size(); f++)
+				total += r.frames[f];
+
+			out << "    {" << endl;
+			out << "      \"name\": \"" << r.name << "\"," << endl;
+			out << "      \"steps\": " << r.frames.size() << "," << endl;
+			out << "      \"steps_per_sec\": " << (total > 0.0 ? r.frames.size() * 1000.0 / total : 0.0) << "," << endl;
+			out << "      \"frame_ms\": { \"p50\": " << r.Percentile(.5) << ", \"p90\": " << r.Percentile(.9) << ", \"p99\": " << r.Percentile(.99)
+				<< ", \"max\": " << r.Percentile(1.) << " }," << endl;
+			out << "      \"allocations_counted\": \"" << (Allocations::CountsAll() ? "all" : "physx") << "\"," << endl;
+			out << "      \"allocations_per_step\": " << (r.frames.size() ? (double)r.allocations / r.frames.size() : 0.0) << "," << endl;
+			out << "      \"peak_since\": \"" << (r.peakReset ? "scenario" : "process") << "\"," << endl;
+			out << "      \"peak_bytes\": " << r.peakBytes << endl;
+			out << "    }" << (i + 1 < results.size() ? "," : "") << endl;
+		}
+		out << "  ]" << endl << "}" << endl;
+	}
+
+	void Suite(const std::vector<std::string>& args)
+	{
+		// Options are named, anything else is taken as a scenario to run.
+		PxU32 steps = 600, balls = 500;
+		bool render = true;
+		std::string json;
+		std::vector<std::string> selected;
+		for (unsigned int i = 1; i < args.size(); i++)
+		{
+			if (args[i] == "-steps" && i + 1 < args.size())
+				steps = Argument(args, ++i, steps);
+			else if (args[i] == "-balls" && i + 1 < args.size())
+				balls = Argument(args, ++i, balls);
+			else if (args[i] == "-json" && i + 1 < args.size())
+				json = args[++i];
+			else if (args[i] == "-norender")
+				render = false;
+			else selected.push_back(args[i]);
+		}
+
+		const char* all[] = { "idle", "autoplay", "multiball", "walls", "resets", "debugrender", "hud" };
+		if (selected.empty())
+			selected.assign(all, all + 7);
+
+		if (render)
+			OpenWindow("Benchmark - Suite");
+
+		std::vector<ScenarioResult> results;
+		for (unsigned int i = 0; i < selected.size(); i++)
+		{
+			const std::string& name = selected[i];
+			bool rendered = (name == "debugrender" || name == "hud");
+			if (rendered && !render)
+			{
+				cerr << "Skipping " << name << ", it needs a window." << endl;
+				continue;
+			}
+
+			VisualDebugger::HUD hud;
+
+			Scenario run;
+			run.capacity = (name == "multiball" || name == "walls") ? balls : 8;
+			run.steps = steps;
+
+			if (name == "autoplay")
+				run.prepare = AutoPlay;
+			else if (name == "multiball")
+				run.balls = balls;
+			else if (name == "walls")
+			{
+				run.balls = balls;
+				run.setup = [](PhysicsEngine::MyScene* scene) { AddLanes(scene, 20, 100); };
+			}
+			else if (name == "resets")
+			{
+				// Rebuild the whole table every second of play, as pressing F12 does.
+				run.step = [](PhysicsEngine::MyScene* scene, PxU32 s) {
+					if (s % 60 == 59)
+						scene->Reset();
+					AutoPlay(scene, s);
+					scene->Update(step_time);
+				};
+			}
+			else if (name == "debugrender")
+			{
+				// Every visualisation the visual debugger offers, drawn on top of the normal scene as in the "both" render mode.
+				run.balls = 8;
+				run.setup = [](PhysicsEngine::MyScene* scene) {
+					scene->Get()->setVisualizationParameter(PxVisualizationParameter::eCONTACT_POINT, 1.f);
+					scene->Get()->setVisualizationParameter(PxVisualizationParameter::eCONTACT_NORMAL, 1.f);
+					scene->Get()->setVisualizationParameter(PxVisualizationParameter::eACTOR_AXES, 1.f);
+					scene->Get()->setVisualizationParameter(PxVisualizationParameter::eBODY_LIN_VELOCITY, 1.f);
+				};
+				run.step = [](PhysicsEngine::MyScene* scene, PxU32 s) {
+					AutoPlay(scene, s);
+					scene->Update(step_time);
+					VisualDebugger::Renderer::Start(PxVec3(0.f, 11.5f, 11.5f), PxVec3(0.f, -2.f, -4.f).getNormalized());
+					VisualDebugger::Renderer::Render(scene->Get()->getRenderBuffer());
+					std::vector<PxActor*> actors = scene->GetAllActors();
+					if (actors.size())
+						VisualDebugger::Renderer::Render(&actors[0], (PxU32)actors.size());
+					VisualDebugger::Renderer::Finish();
+				};
+			}
+			else if (name == "hud")
+			{
+				// A full screen of live fields, every one of them edited each frame as the score and lives fields are.
+				hud.AddLine(VisualDebugger::EMPTY, "");
+				for (PxU32 l = 0; l < 50; l++)
+					hud.AddLine(VisualDebugger::SCORE, "Field " + to_string(l) + ": $", true);
+				hud.FontSize(0.018f);
+				hud.ActiveScreen(VisualDebugger::SCORE);
+
+				run.step = [&](PhysicsEngine::MyScene* scene, PxU32 s) {
+					AutoPlay(scene, s);
+					scene->Update(step_time);
+					for (PxU32 l = 0; l < 50; l++)
+						hud.EditLine(VisualDebugger::SCORE, l, (int)(s + l));
+					VisualDebugger::Renderer::Start(PxVec3(0.f, 11.5f, 11.5f), PxVec3(0.f, -2.f, -4.f).getNormalized());
+					std::vector<PxActor*> actors = scene->GetAllActors();
+					if (actors.size())
+						VisualDebugger::Renderer::Render(&actors[0], (PxU32)actors.size());
+					hud.Render();
+					VisualDebugger::Renderer::Finish();
+				};
+			}
+			else if (name != "idle")
+			{
+				cerr << "Unknown scenario " << name << "." << endl;
+				continue;
+			}
+
+			Measure(run);
+
+			ScenarioResult result = { name, run.frames, run.allocations, run.peakBytes, run.peakReset };
+			results.push_back(result);
+		}
+
+		if (json.empty())
+			WriteJson(cout, results);
+		else
+		{
+			ofstream file(json.c_str());
+			WriteJson(file, results);
+		}
+	}
+}
\ No newline at end of file
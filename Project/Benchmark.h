@@ -0,0 +1,64 @@
+#ifndef benchmark_h
+#define benchmark_h
+
+#include <string>
+#include <vector>
+#include "MyPhysicsEngine.h"
+#include "SceneQuery.h"
+#include "Rollback.h"
+#include "Extras/Renderer.h"
+#include "Extras/Profiler.h"
+
+namespace Benchmark
+{
+	using namespace physx;
+
+	// Run the benchmark named by args[0], the remaining arguments are passed to that benchmark. Returns false if the
+	// name was not recognised.
+	bool Run(const std::vector<std::string>& args);
+
+	// Scale the multiball pool from 1 to maxBalls pinballs, reporting simulate, contact callback and render time per step.
+	void MultiballScaling(PxU32 maxBalls = 5000, PxU32 steps = 120, bool render = true);
+
+	// Compare sweep-and-prune against multi-box pruning on the stock table and on a table with denseBalls pinballs.
+	void Broadphase(PxU32 denseBalls = 1000, PxU32 steps = 300);
+
+	// Time batches of line-of-sight raycasts and ball sweeps against the stock table on 1, 2 and 4 threads.
+	void Queries(PxU32 queries = 4096, PxU32 steps = 120);
+
+	// Measure the cost of streaming telemetry for balls pinballs against the same scene without it, then scan the file.
+	void TelemetryOverhead(PxU32 balls = 256, PxU32 steps = 600);
+
+	// Time saving and loading a snapshot and rolling back resimulated steps with balls pinballs in play, against a 16ms frame.
+	void RollbackCost(PxU32 balls = 64, PxU32 resimulated = 8, PxU32 rounds = 60);
+
+	// Play a scripted game of plunger launches and flipper presses with no, adaptive and constant substepping.
+	void Substepping(PxU32 steps = 1200);
+
+	// Leave the stock table untouched and report awake bodies, wake/sleep events and simulate time for each second.
+	void Idle(PxU32 seconds = 20);
+
+	// Compare callback time and reported contacts for each contact reporting mode on a multiball table.
+	void ContactReports(PxU32 balls = 500, PxU32 steps = 600);
+
+	// Launch balls across the table at high speed under each CCD policy while the flippers swing, counting balls which
+	// tunnel out of the table or through a flipper.
+	void CCDPolicies(PxU32 balls = 200, PxU32 speed = 40, PxU32 steps = 300);
+
+	// Compare contact generation between the table built from individual walls and the same table baked into triangle meshes.
+	void StaticBaking(PxU32 balls = 500, PxU32 steps = 600);
+
+	// Compare a bowl sculpted from a resolution x resolution height field against the same bowl built from box segments.
+	void HeightFieldBowl(PxU32 resolution = 32, PxU32 balls = 200, PxU32 steps = 600, bool render = true);
+
+	// Time each of the batched Mathv kernels against the equivalent PxTransform loop over arrays of count elements.
+	void MathKernels(PxU32 count = 4096, PxU32 rounds = 1000);
+
+	// Run the named scenarios (all of them when none are given) and report steps per second, frame time percentiles,
+	// allocations per step and peak memory for each as JSON, to stdout or to the file given by -json. Only PhysX
+	// allocations are counted unless built with the Benchmark configuration, see COUNT_ALLOCATIONS. The peak covers each
+	// scenario where the OS can reset it (Linux), otherwise it is the process's peak so far, see peak_since.
+	void Suite(const std::vector<std::string>& args);
+}
+
+#endif
\ No newline at end of file
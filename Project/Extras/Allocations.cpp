@@ -0,0 +1,123 @@
+#include "Allocations.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#elif defined(__linux__)
+#include <cstdio>
+#endif
+
+namespace
+{
+	std::atomic<unsigned long long> count(0);
+}
+
+namespace Allocations
+{
+	void Add()
+	{
+		count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	unsigned long long Count()
+	{
+		return count.load(std::memory_order_relaxed);
+	}
+
+	bool CountsAll()
+	{
+#ifdef COUNT_ALLOCATIONS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	unsigned long long PeakBytes()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS_EX counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters)))
+			return counters.PeakPagefileUsage;
+#elif defined(__linux__)
+		// VmHWM is the resident set's high water mark, in kB.
+		unsigned long long peak = 0;
+		if (FILE* status = fopen("/proc/self/status", "r"))
+		{
+			char line[128];
+			while (fgets(line, sizeof(line), status))
+				if (sscanf(line, "VmHWM: %llu", &peak) == 1)
+					break;
+			fclose(status);
+			return peak * 1024;
+		}
+#endif
+		return 0;
+	}
+
+	bool ResetPeak()
+	{
+#if defined(__linux__)
+		// Writing 5 to clear_refs resets VmHWM to the current resident set size.
+		if (FILE* refs = fopen("/proc/self/clear_refs", "w"))
+		{
+			bool reset = fputs("5", refs) >= 0;
+			return (fclose(refs) == 0) && reset;
+		}
+#endif
+		return false;
+	}
+}
+
+#ifdef COUNT_ALLOCATIONS
+// Replacing the global allocation functions counts every C++ allocation in the process, the memory itself still comes
+// from malloc and only a relaxed increment is added to each call. This is only done in the Benchmark configuration, so
+// that the game itself keeps the runtime's allocator untouched.
+void* operator new(size_t size)
+{
+	Allocations::Add();
+	if (void* ptr = malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw()
+{
+	Allocations::Add();
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw()
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) throw()
+{
+	free(ptr);
+}
+#endif
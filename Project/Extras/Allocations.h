@@ -0,0 +1,50 @@
+#ifndef allocations_h
+#define allocations_h
+
+#include "PxPhysicsAPI.h"
+
+/// <summary>
+/// Process-wide allocation statistics. Every PhysX allocation made through CountingAllocator is counted, and in builds
+/// with COUNT_ALLOCATIONS defined (the Benchmark configuration) so is every C++ allocation made through the global
+/// operator new. The count is only ever read as a difference between two points.
+/// </summary>
+namespace Allocations
+{
+	void Add();
+
+	unsigned long long Count();
+
+	// Whether C++ allocations are counted as well as PhysX ones, see COUNT_ALLOCATIONS.
+	bool CountsAll();
+
+	// Most memory the process has used according to the OS: peak private bytes on Windows, peak resident bytes on Linux and
+	// 0 where neither is available. This is the peak since the process started, or since the last successful ResetPeak.
+	unsigned long long PeakBytes();
+
+	// Start measuring the peak afresh from the current usage, returns false where the OS cannot (Windows), in which case
+	// PeakBytes stays the peak of the whole process.
+	bool ResetPeak();
+}
+
+/// <summary>
+/// The default PhysX allocator with every allocation counted in Allocations.
+/// </summary>
+class CountingAllocator : public physx::PxAllocatorCallback
+{
+	private:
+		physx::PxDefaultAllocator _base;
+
+	public:
+		void* allocate(size_t size, const char* typeName, const char* filename, int line)
+		{
+			Allocations::Add();
+			return _base.allocate(size, typeName, filename, line);
+		}
+
+		void deallocate(void* ptr)
+		{
+			_base.deallocate(ptr);
+		}
+};
+
+#endif
@@ -2,25 +2,67 @@
 
 LColor* LColor::_instance = nullptr;
 
+// The built-in colours, in the order of LColor::Palette so that each enumerator indexes its own colour.
+static const struct { const char* name; PxVec3 color; } BUILTIN[] = {
+	{ "white", PxVec3(1.f) },
+	{ "gray-20", PxVec3(.2f) },
+	{ "soft-red", PxVec3(1.f,.3f,.3f) },
+	{ "soft-green", PxVec3(.3f,1.f,.3f) },
+	{ "soft-blue", PxVec3(.3f,.3f,1.f) },
+	{ "soft-orange", PxVec3(1.f,.65f,.3f) },
+	{ "soft-purple", PxVec3(.65f,.3f,1.f) }
+};
+static_assert(sizeof(BUILTIN) / sizeof(BUILTIN[0]) == LColor::PALETTE_SIZE, "LColor's built-in table is out of sync with LColor::Palette.");
+
+LColor::LColor()
+{
+	// Populate the packed palette with the built-in colours, so that each Palette enumerator is its colour's index.
+	_palette.reserve(PALETTE_SIZE);
+	_names.reserve(PALETTE_SIZE);
+	for (PxU32 i = 0; i < PALETTE_SIZE; i++)
+		Add(BUILTIN[i].name, BUILTIN[i].color);
+}
+
+PxU32 LColor::Add(const char* name, const PxVec3& color)
+{
+	// Append the colour to the packed palette and register its hashed name for runtime lookups.
+	PxU32 index = (PxU32)_palette.size();
+	_palette.push_back(color);
+	_names.push_back(name);
+	_lookup.insert(std::make_pair(Hash(name), index));
+	return index;
+}
+
+int LColor::Index(const char* id) const
+{
+	// Retrieve the palette index of a name, or -1 if no colour has been registered with that name. The hash narrows the
+	// search down and the name decides, so a colour whose name happens to share a hash is never returned instead.
+	if (!id || *id == '\0')
+		return -1;
+
+	typedef std::unordered_multimap<Id, PxU32>::const_iterator Iterator;
+	std::pair<Iterator, Iterator> range = _lookup.equal_range(Hash(id));
+	for (Iterator it = range.first; it != range.second; ++it)
+		if (_names[it->second] == id)
+			return (int)it->second;
+	return -1;
+}
+
 const PxVec3 LColor::Fetch(const char* id, float r, float g, float b)
 {
 	// Fetch a colour based on a provided string ID or create a new colour with the provided ID.
-	if (id == "")
+	if (!id || *id == '\0')
 	{
 		std::cerr << "Color (rgb=" << r << "," << g << "," << b << ") fetch failed, invalid ID!" << std::endl;
 		return PxVec3(0.f);
 	}
 
-	int size = _colors.size();
-	for (int i = 0; i < size; i++)
-	{
-		if (_colors[i]->id == id)
-			return _colors[i]->color;
-	}
+	int index = Index(id);
+	if (index != -1)
+		return _palette[index];
 
 	std::cout << "Color (id=" << id << ", rgb=" << r << "," << g << "," << b << ") added." << std::endl;
 
 	// This allows exact colours to be stored and re-used.
-	_colors.push_back(new ColorData(id, PxVec3(r, g, b)));
-	return _colors[size - 1]->color;
+	return _palette[Add(id, PxVec3(r, g, b))];
 }
\ No newline at end of file
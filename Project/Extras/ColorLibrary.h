@@ -1,29 +1,23 @@
 #ifndef colorlibrary_h
 #define colorlibrary_h
 
+#include <string>
 #include <vector>
+#include <unordered_map>
 #include <iostream>
 #include "PxPhysicsAPI.h"
 
 using physx::PxVec3;
+using physx::PxU32;
 
 class LColor
 {
-	struct ColorData
-	{
-		const char* id;
-		const PxVec3 color;
-
-		ColorData(const char* _id, const PxVec3 _color)
-			: id(_id), color(_color) { }
-	};
-
 	/// SINGLETON
 	/// Private singleton members, this hides the constructor, destructor and copy constructor.
 	private:
 		static LColor* _instance;
 
-		LColor() { }
+		LColor();
 		LColor(const LColor& other) { }
 		~LColor() { }
 	/// SINGLETON
@@ -40,19 +34,41 @@ class LColor
 		}
 	/// SINGLETON
 
-	private:
-		std::vector<ColorData*> _colors = {
-			new ColorData("white", PxVec3(1.f)),
-			new ColorData("gray-20", PxVec3(.2f)),
-			new ColorData("soft-red", PxVec3(1.f,.3f,.3f)),
-			new ColorData("soft-green", PxVec3(.3f,1.f,.3f)),
-			new ColorData("soft-blue", PxVec3(.3f,.3f,1.f)),
-			new ColorData("soft-orange", PxVec3(1.f,.65f,.3f)),
-			new ColorData("soft-purple", PxVec3(.65f,.3f,1.f))
+	public:
+		typedef PxU32 Id;
+
+		// The built-in palette, each value is the index of that colour within the packed palette array. The order here must
+		// match the built-in table in ColorLibrary.cpp.
+		enum Palette : PxU32
+		{
+			WHITE = 0,
+			GRAY_20,
+			SOFT_RED,
+			SOFT_GREEN,
+			SOFT_BLUE,
+			SOFT_ORANGE,
+			SOFT_PURPLE,
+			PALETTE_SIZE
 		};
 
+		// 32-bit FNV-1a hash of a colour name, which narrows a lookup down before the names are compared.
+		static constexpr Id Hash(const char* str, Id hash = 2166136261u)
+		{
+			return (*str == '\0') ? hash : Hash(str + 1, (hash ^ (Id)(unsigned char)*str) * 16777619u);
+		}
+
+	private:
+		std::vector<PxVec3> _palette;				// Packed colour storage, indexed by Palette and by Index.
+		std::vector<std::string> _names;			// Name of each palette entry, compared on a hash match.
+		std::unordered_multimap<Id, PxU32> _lookup;	// Hashed name to palette index, two names may share a hash.
+
+		PxU32 Add(const char* name, const PxVec3& color);
+
 	public:
+		const PxVec3& Fetch(Palette index) const { return _palette[index]; }
 		const PxVec3 Fetch(const char* id, float r = 0.f, float g = 0.f, float b = 0.f);
+
+		int Index(const char* id) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef eventqueue_h
+#define eventqueue_h
+
+#include <atomic>
+#include <vector>
+#include "PxPhysicsAPI.h"
+
+/// <summary>
+/// A compact record of a simulation event, written by the simulation callbacks and consumed by the game logic.
+/// </summary>
+struct GameEvent
+{
+	enum Type : physx::PxU32
+	{
+		TRIGGER_FOUND,
+		TRIGGER_LOST,
+		CONTACT_FOUND,
+		CONTACT_LOST,
+		COUNT
+	};
+
+	physx::PxU32 type;
+	physx::PxU32 step;					// Index of the simulation step which produced this event.
+	physx::PxShape* shapes[2];			// [0] the player (or other) shape, [1] the trigger or the shape it touched.
+	physx::PxFilterData filters[2];		// Simulation filter data of both shapes at the time of the event.
+	physx::PxReal impulse;				// Total contact impulse magnitude, zero unless SimulationCallback::contactImpulses is set.
+	physx::PxU64 timestamp;				// Wall-clock time in microseconds.
+};
+
+/// <summary>
+/// A fixed-capacity single-producer/single-consumer ring buffer. Push and Pop never allocate or lock, the storage is
+/// allocated once on construction and the capacity is rounded up to a power of two.
+/// </summary>
+template <typename T>
+class RingBuffer
+{
+	private:
+		std::vector<T> _items;
+		physx::PxU32 _mask;
+		std::atomic<physx::PxU32> _head;		// Next slot to read, only written by the consumer.
+		std::atomic<physx::PxU32> _tail;		// Next slot to write, only written by the producer.
+		std::atomic<physx::PxU32> _dropped;
+
+	public:
+		RingBuffer(physx::PxU32 capacity)
+			: _head(0), _tail(0), _dropped(0)
+		{
+			physx::PxU32 size = 1;
+			while (size < capacity)
+				size <<= 1;
+
+			_items.resize(size);
+			_mask = size - 1;
+		}
+
+		bool Push(const T& item)
+		{
+			// Producer side, fails (and counts the drop) if the consumer has not yet freed a slot.
+			physx::PxU32 tail = _tail.load(std::memory_order_relaxed);
+			if (tail - _head.load(std::memory_order_acquire) > _mask)
+			{
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			_items[tail & _mask] = item;
+			_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool Pop(T& item)
+		{
+			// Consumer side, returns false when the buffer is empty.
+			physx::PxU32 head = _head.load(std::memory_order_relaxed);
+			if (head == _tail.load(std::memory_order_acquire))
+				return false;
+
+			item = _items[head & _mask];
+			_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		physx::PxU32 Size() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); }
+		physx::PxU32 Capacity() const { return _mask + 1; }
+		physx::PxU32 Dropped() const { return _dropped.load(std::memory_order_relaxed); }
+};
+
+typedef RingBuffer<GameEvent> EventQueue;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef filtertable_h
+#define filtertable_h
+
+#include <utility>
+#include "PxPhysicsAPI.h"
+
+// What should happen when shapes of two filter groups meet.
+struct FilterFlag
+{
+	enum Enum : physx::PxU8
+	{
+		IGNORE = 0,				// The pair is killed and never reaches the solver or the callbacks.
+		SOLVE = (1 << 0),		// Discrete contacts are generated and solved.
+		CCD = (1 << 1),			// Continuous collision detection is enabled for the pair.
+		NOTIFY = (1 << 2),		// Contacts are reported to the simulation callback, using the scene's notify flags.
+		TRIGGER = (1 << 3)		// If either shape is a trigger, the pair reports trigger enter and leave.
+	};
+};
+
+// A single entry in a rule table. Groups are simulation filter word0 values, i.e. a single FilterGroup bit or 0 for
+// scenery which belongs to no group. Rules are symmetric, so each pair only needs listing once.
+struct FilterRule
+{
+	physx::PxU32 group0;
+	physx::PxU32 group1;
+	physx::PxU8 flags;
+};
+
+// The filter shader's constant block. Pairs with the NOTIFY flag use these pair flags, so the amount of contact data
+// reported can change without changing the rules. Without a constant block, touch found and lost are reported.
+struct FilterShaderBlock
+{
+	physx::PxU32 notifyFlags;
+};
+
+// Resolves a rule table into a flat lookup table at compile time, see FilterTable. Kept separate so that the table is
+// complete, and its constexpr functions usable, before FilterTable initialises its entries from it.
+template <typename Rules, physx::PxU32 GroupBits>
+struct FilterTableBuilder
+{
+	static const physx::PxU32 SIZE = 1u << GroupBits;
+
+	struct Entries
+	{
+		physx::PxU8 flags[SIZE * SIZE];
+	};
+
+	// The flags of the first rule listing this pair of groups, in either order, or the fallback if there is none.
+	static constexpr physx::PxU8 Lookup(physx::PxU32 group0, physx::PxU32 group1, physx::PxU32 i = 0)
+	{
+		return i == Rules::count ? Rules::fallback :
+			((Rules::rules[i].group0 == group0 && Rules::rules[i].group1 == group1) || (Rules::rules[i].group0 == group1 && Rules::rules[i].group1 == group0)) ?
+			Rules::rules[i].flags : Lookup(group0, group1, i + 1);
+	}
+
+	// Every group named by a rule must fit in the table.
+	static constexpr bool Fits(physx::PxU32 i = 0)
+	{
+		return i == Rules::count || (Rules::rules[i].group0 < SIZE && Rules::rules[i].group1 < SIZE && Fits(i + 1));
+	}
+
+	template <size_t... I>
+	static constexpr Entries Build(std::index_sequence<I...>)
+	{
+		return Entries{ { Lookup(I / SIZE, I % SIZE)... } };
+	}
+};
+
+/// <summary>
+/// Generates a filter shader from a rule table at compile time. Rules must provide a constexpr array of FilterRule named
+/// rules, its count, and the fallback flags for pairs which no rule lists. Every combination of group words below
+/// 2^GroupBits is resolved into a flat lookup table when compiling, so filtering a pair is one load and a few masks.
+/// </summary>
+template <typename Rules, physx::PxU32 GroupBits>
+class FilterTable
+{
+	typedef FilterTableBuilder<Rules, GroupBits> Builder;
+
+	static_assert(Builder::Fits(), "FilterTable: a rule names a group which does not fit in GroupBits, increase GroupBits.");
+
+	public:
+		static const physx::PxU32 SIZE = Builder::SIZE;
+		static constexpr physx::PxU32 DefaultNotify = physx::PxPairFlag::eNOTIFY_TOUCH_FOUND | physx::PxPairFlag::eNOTIFY_TOUCH_LOST;
+
+		static constexpr typename Builder::Entries entries = Builder::Build(std::make_index_sequence<SIZE * SIZE>());
+
+		// Pair flags for a resolved rule, written without branches. The shader is this and a table lookup.
+		static constexpr physx::PxU32 PairFlags(physx::PxU8 rule, bool trigger, physx::PxU32 notify)
+		{
+			return ((0u - (physx::PxU32)trigger) & ((0u - (physx::PxU32)((rule & FilterFlag::TRIGGER) != 0)) & physx::PxPairFlag::eTRIGGER_DEFAULT)) |
+				(~(0u - (physx::PxU32)trigger) & (
+					((0u - (physx::PxU32)((rule & FilterFlag::SOLVE) != 0)) & (physx::PxPairFlag::eSOLVE_CONTACT | physx::PxPairFlag::eDETECT_DISCRETE_CONTACT)) |
+					((0u - (physx::PxU32)((rule & FilterFlag::CCD) != 0)) & physx::PxPairFlag::eDETECT_CCD_CONTACT) |
+					((0u - (physx::PxU32)((rule & FilterFlag::NOTIFY) != 0)) & notify)));
+		}
+
+		static physx::PxFilterFlags Shader(physx::PxFilterObjectAttributes attributes0, physx::PxFilterData filterData0,
+			physx::PxFilterObjectAttributes attributes1, physx::PxFilterData filterData1,
+			physx::PxPairFlags& pairFlags, const void* constantBlock, physx::PxU32 constantBlockSize)
+		{
+			physx::PxU8 rule = entries.flags[(filterData0.word0 & (SIZE - 1)) * SIZE + (filterData1.word0 & (SIZE - 1))];
+			bool trigger = physx::PxFilterObjectIsTrigger(attributes0) | physx::PxFilterObjectIsTrigger(attributes1);
+			physx::PxU32 notify = constantBlockSize >= sizeof(FilterShaderBlock) ? ((const FilterShaderBlock*)constantBlock)->notifyFlags : DefaultNotify;
+
+			// A pair with nothing to do is killed, so it costs nothing until its filter data changes.
+			physx::PxU32 flags = PairFlags(rule, trigger, notify);
+			pairFlags = physx::PxPairFlags((physx::PxU16)flags);
+			return physx::PxFilterFlags((physx::PxU16)(physx::PxFilterFlag::eKILL * (flags == 0)));
+		}
+};
+
+template <typename Rules, physx::PxU32 GroupBits>
+constexpr typename FilterTableBuilder<Rules, GroupBits>::Entries FilterTable<Rules, GroupBits>::entries;
+
+template <typename Rules, physx::PxU32 GroupBits>
+constexpr physx::PxU32 FilterTable<Rules, GroupBits>::DefaultNotify;
+
+#endif
\ No newline at end of file
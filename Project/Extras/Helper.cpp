@@ -1,5 +1,15 @@
 #include "Helper.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MATHV_SSE
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define MATHV_AVX
+#include <immintrin.h>
+#endif
+
 PxQuat Mathv::EulerToQuat(float x, float y, float z)
 {
 	// Very basic trigonometry to calculate a PxQuat from a provided set of X, Y, and Z values (euler angles).
@@ -54,14 +64,19 @@ std::vector<PxVec3> Mathv::Plot(PxVec3 start, float startRads, float radVarience
 {
 	// Plot (PxPi*2 / radVarience) number of elements around a central point, each moving in radial increments of radVarience.
 	// The initial rotation is set by startRads and the scalar can amplify the radius of the plotted points.
+	// Only the first point is rotated on its own, every pass after that rotates all of the points plotted so far onto the
+	// next empty stretch of the array with the batched Rotate, so n points cost log2(n) batched calls.
 	int size = (PxPi * 2.f) / radVarience;
 	std::vector<PxVec3> arr = std::vector<PxVec3>(size);
+	if (size == 0)
+		return arr;
+
+	arr[0] = Rotate(start, startRads, PxVec3(1, 0, 0));
+	for (int filled = 1; filled < size; filled *= 2)
+		Rotate(PxQuat(radVarience * filled, PxVec3(0, 0, 1)), &arr[0], &arr[filled], PxMin(filled, size - filled));
 
 	for (int i = 0; i < size; i++)
-	{
-		arr[i] = Rotate(start, startRads, PxVec3(1, 0, 0)).multiply(scalar);
-		startRads += radVarience;
-	}
+		arr[i] = arr[i].multiply(scalar);
 
 	return arr;
 }
@@ -100,4 +115,232 @@ PxTransform Mathv::Multiply(PxTransform t, PxQuat q)
 {
 	// Simple multiplaction extensions for multiplying a PxQuat within a PxTransform by another given PxQuat.
 	return PxTransform(t.p, t.q * q);
-}
\ No newline at end of file
+}
+
+#ifdef MATHV_SSE
+namespace
+{
+	// Split four packed PxVec3s, loaded as three registers, into one register per axis.
+	inline void Deinterleave(const float* in, __m128& x, __m128& y, __m128& z)
+	{
+		__m128 a = _mm_loadu_ps(in), b = _mm_loadu_ps(in + 4), c = _mm_loadu_ps(in + 8);
+		x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+		y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+	}
+
+	// The reverse of Deinterleave, packing one register per axis back into four PxVec3s.
+	inline void Interleave(__m128 x, __m128 y, __m128 z, float* out)
+	{
+		_mm_storeu_ps(out, _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(out + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(out + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+}
+#endif
+
+void Mathv::Rotate(const PxQuat& q, const PxVec3* in, PxVec3* out, PxU32 count)
+{
+	// A rotation is a transform without the translation.
+	Transform(PxTransform(PxVec3(0.f), q), in, out, count);
+}
+
+void Mathv::Transform(const PxTransform& t, const PxVec3* in, PxVec3* out, PxU32 count)
+{
+	// The quaternion is expanded into a matrix once, each point then costs nine multiplies and nine adds.
+	PxMat33 m(t.q);
+	PxU32 i = 0;
+
+#ifdef MATHV_AVX
+	__m256 m8[9], p8[3];
+	for (PxU32 k = 0; k < 9; k++)
+		m8[k] = _mm256_set1_ps(m[k / 3][k % 3]);
+	for (PxU32 k = 0; k < 3; k++)
+		p8[k] = _mm256_set1_ps(t.p[k]);
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128 x0, y0, z0, x1, y1, z1;
+		Deinterleave(&in[i].x, x0, y0, z0);
+		Deinterleave(&in[i + 4].x, x1, y1, z1);
+		__m256 x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+		__m256 y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+		__m256 z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+
+		// m[c][r] is column c, row r.
+		__m256 rx = _mm256_add_ps(p8[0], _mm256_add_ps(_mm256_mul_ps(m8[0], x), _mm256_add_ps(_mm256_mul_ps(m8[3], y), _mm256_mul_ps(m8[6], z))));
+		__m256 ry = _mm256_add_ps(p8[1], _mm256_add_ps(_mm256_mul_ps(m8[1], x), _mm256_add_ps(_mm256_mul_ps(m8[4], y), _mm256_mul_ps(m8[7], z))));
+		__m256 rz = _mm256_add_ps(p8[2], _mm256_add_ps(_mm256_mul_ps(m8[2], x), _mm256_add_ps(_mm256_mul_ps(m8[5], y), _mm256_mul_ps(m8[8], z))));
+
+		Interleave(_mm256_castps256_ps128(rx), _mm256_castps256_ps128(ry), _mm256_castps256_ps128(rz), &out[i].x);
+		Interleave(_mm256_extractf128_ps(rx, 1), _mm256_extractf128_ps(ry, 1), _mm256_extractf128_ps(rz, 1), &out[i + 4].x);
+	}
+#endif
+
+#ifdef MATHV_SSE
+	__m128 m4[9], p4[3];
+	for (PxU32 k = 0; k < 9; k++)
+		m4[k] = _mm_set1_ps(m[k / 3][k % 3]);
+	for (PxU32 k = 0; k < 3; k++)
+		p4[k] = _mm_set1_ps(t.p[k]);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x, y, z;
+		Deinterleave(&in[i].x, x, y, z);
+
+		__m128 rx = _mm_add_ps(p4[0], _mm_add_ps(_mm_mul_ps(m4[0], x), _mm_add_ps(_mm_mul_ps(m4[3], y), _mm_mul_ps(m4[6], z))));
+		__m128 ry = _mm_add_ps(p4[1], _mm_add_ps(_mm_mul_ps(m4[1], x), _mm_add_ps(_mm_mul_ps(m4[4], y), _mm_mul_ps(m4[7], z))));
+		__m128 rz = _mm_add_ps(p4[2], _mm_add_ps(_mm_mul_ps(m4[2], x), _mm_add_ps(_mm_mul_ps(m4[5], y), _mm_mul_ps(m4[8], z))));
+
+		Interleave(rx, ry, rz, &out[i].x);
+	}
+#endif
+
+	for (; i < count; i++)
+		out[i] = m * in[i] + t.p;
+}
+
+void Mathv::Multiply(const PxTransform& parent, const PxTransform* local, PxTransform* out, PxU32 count)
+{
+	// out = parent * local, rotating and offsetting each local position and combining the rotations.
+	PxMat33 m(parent.q);
+	PxU32 i = 0;
+
+#ifdef MATHV_SSE
+	__m128 m4[9], p4[3];
+	for (PxU32 k = 0; k < 9; k++)
+		m4[k] = _mm_set1_ps(m[k / 3][k % 3]);
+	for (PxU32 k = 0; k < 3; k++)
+		p4[k] = _mm_set1_ps(parent.p[k]);
+	__m128 ax = _mm_set1_ps(parent.q.x), ay = _mm_set1_ps(parent.q.y), az = _mm_set1_ps(parent.q.z), aw = _mm_set1_ps(parent.q.w);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		// A PxTransform is a quaternion followed by a position, reading from q.w picks up (w, p.x, p.y, p.z) without leaving
+		// the transform. After transposing, the registers hold one component of all four transforms each.
+		__m128 bx = _mm_loadu_ps(&local[i].q.x), by = _mm_loadu_ps(&local[i + 1].q.x), bz = _mm_loadu_ps(&local[i + 2].q.x), bw = _mm_loadu_ps(&local[i + 3].q.x);
+		_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+		__m128 w = _mm_loadu_ps(&local[i].q.w), x = _mm_loadu_ps(&local[i + 1].q.w), y = _mm_loadu_ps(&local[i + 2].q.w), z = _mm_loadu_ps(&local[i + 3].q.w);
+		_MM_TRANSPOSE4_PS(w, x, y, z);
+
+		__m128 qx = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(aw, bx), _mm_mul_ps(ax, bw)), _mm_mul_ps(ay, bz)), _mm_mul_ps(az, by));
+		__m128 qy = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(aw, by), _mm_mul_ps(ay, bw)), _mm_mul_ps(az, bx)), _mm_mul_ps(ax, bz));
+		__m128 qz = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(aw, bz), _mm_mul_ps(az, bw)), _mm_mul_ps(ax, by)), _mm_mul_ps(ay, bx));
+		__m128 qw = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(aw, bw), _mm_mul_ps(ax, bx)), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+
+		__m128 px = _mm_add_ps(p4[0], _mm_add_ps(_mm_mul_ps(m4[0], x), _mm_add_ps(_mm_mul_ps(m4[3], y), _mm_mul_ps(m4[6], z))));
+		__m128 py = _mm_add_ps(p4[1], _mm_add_ps(_mm_mul_ps(m4[1], x), _mm_add_ps(_mm_mul_ps(m4[4], y), _mm_mul_ps(m4[7], z))));
+		__m128 pz = _mm_add_ps(p4[2], _mm_add_ps(_mm_mul_ps(m4[2], x), _mm_add_ps(_mm_mul_ps(m4[5], y), _mm_mul_ps(m4[8], z))));
+
+		// Write (w, p) first and the quaternion second, the two stores overlap on w.
+		__m128 w0 = qw, p0 = px, p1 = py, p2 = pz;
+		_MM_TRANSPOSE4_PS(w0, p0, p1, p2);
+		_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+		__m128 tail[4] = { w0, p0, p1, p2 }, head[4] = { qx, qy, qz, qw };
+		for (PxU32 k = 0; k < 4; k++)
+		{
+			_mm_storeu_ps(&out[i + k].q.w, tail[k]);
+			_mm_storeu_ps(&out[i + k].q.x, head[k]);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		out[i] = PxTransform(m * local[i].p + parent.p, parent.q * local[i].q);
+}
+
+void Mathv::ToMatrices(const PxTransform* t, PxMat44* out, PxU32 count)
+{
+	// Expand each transform into the column-major matrix expected by OpenGL, as PxMat44(PxTransform) would.
+	PxU32 i = 0;
+
+#ifdef MATHV_SSE
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f), two = _mm_set1_ps(2.f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&t[i].q.x), y = _mm_loadu_ps(&t[i + 1].q.x), z = _mm_loadu_ps(&t[i + 2].q.x), w = _mm_loadu_ps(&t[i + 3].q.x);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		__m128 pw = _mm_loadu_ps(&t[i].q.w), px = _mm_loadu_ps(&t[i + 1].q.w), py = _mm_loadu_ps(&t[i + 2].q.w), pz = _mm_loadu_ps(&t[i + 3].q.w);
+		_MM_TRANSPOSE4_PS(pw, px, py, pz);
+
+		__m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 xw = _mm_mul_ps(w, x2), yw = _mm_mul_ps(w, y2), zw = _mm_mul_ps(w, z2);
+
+		// Columns are built one component per register and then transposed so that each register is one matrix's column.
+		__m128 c[4][4] = {
+			{ _mm_sub_ps(one, _mm_add_ps(yy, zz)), _mm_add_ps(xy, zw), _mm_sub_ps(xz, yw), zero },
+			{ _mm_sub_ps(xy, zw), _mm_sub_ps(one, _mm_add_ps(xx, zz)), _mm_add_ps(yz, xw), zero },
+			{ _mm_add_ps(xz, yw), _mm_sub_ps(yz, xw), _mm_sub_ps(one, _mm_add_ps(xx, yy)), zero },
+			{ px, py, pz, one }
+		};
+
+		for (PxU32 k = 0; k < 4; k++)
+		{
+			_MM_TRANSPOSE4_PS(c[k][0], c[k][1], c[k][2], c[k][3]);
+			for (PxU32 j = 0; j < 4; j++)
+				_mm_storeu_ps(&out[i + j][k].x, c[k][j]);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		out[i] = PxMat44(t[i]);
+}
+
+void Mathv::QuadNormals(const PxVec4* points, PxU32 count, const PxU32* quads, PxU32 quadCount, PxVec4* normals)
+{
+	// Each quad's normal comes from its first three vertices and is added to all four, the sums are normalised at the end.
+#ifdef MATHV_SSE
+	// The w lanes cancel in the cross product, so the normals' w stays zero whatever the points hold there.
+	const __m128 zero = _mm_setzero_ps();
+	for (PxU32 i = 0; i < count; i++)
+		_mm_storeu_ps(&normals[i].x, zero);
+
+	for (PxU32 i = 0; i < quadCount * 4; i += 4)
+	{
+		__m128 v0 = _mm_loadu_ps(&points[quads[i]].x);
+		__m128 a = _mm_sub_ps(_mm_loadu_ps(&points[quads[i + 1]].x), v0);
+		__m128 b = _mm_sub_ps(_mm_loadu_ps(&points[quads[i + 2]].x), v0);
+
+		// n = b x a
+		__m128 n = _mm_sub_ps(
+			_mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2))),
+			_mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1))));
+
+		for (PxU32 j = 0; j < 4; j++)
+			_mm_storeu_ps(&normals[quads[i + j]].x, _mm_add_ps(_mm_loadu_ps(&normals[quads[i + j]].x), n));
+	}
+
+	const __m128 epsilon = _mm_set1_ps(1e-12f);
+	for (PxU32 i = 0; i < count; i++)
+	{
+		__m128 n = _mm_loadu_ps(&normals[i].x);
+		__m128 sq = _mm_mul_ps(n, n);
+		__m128 len = _mm_add_ps(sq, _mm_add_ps(_mm_shuffle_ps(sq, sq, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(3, 1, 0, 2))));
+		_mm_storeu_ps(&normals[i].x, _mm_div_ps(n, _mm_sqrt_ps(_mm_max_ps(len, epsilon))));
+	}
+#else
+	for (PxU32 i = 0; i < count; i++)
+		normals[i] = PxVec4(0.f);
+
+	for (PxU32 i = 0; i < quadCount * 4; i += 4)
+	{
+		PxVec3 v0 = points[quads[i]].getXYZ();
+		PxVec3 n = (points[quads[i + 2]].getXYZ() - v0).cross(points[quads[i + 1]].getXYZ() - v0);
+
+		for (PxU32 j = 0; j < 4; j++)
+			normals[quads[i + j]] += PxVec4(n, 0.f);
+	}
+
+	for (PxU32 i = 0; i < count; i++)
+	{
+		PxVec3 n = normals[i].getXYZ();
+		n.normalizeSafe();
+		normals[i] = PxVec4(n, 0.f);
+	}
+#endif
+}
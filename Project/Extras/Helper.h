@@ -17,6 +17,17 @@ class Mathv
 		static std::vector<PxVec3> Plot(PxVec3 start, float startRads, float radVarience, PxVec3 scalar = PxVec3(1.f));
 		static PxVec3 Multiply(PxQuat quat, PxVec3 vec);
 		static PxTransform Multiply(PxTransform t, PxQuat q);
+
+		// Batched kernels for arrays, processed four at a time with SSE (eight with AVX for points) and the remainder, or the
+		// whole array on other targets, with the equivalent scalar code. The output may be the same array as the input.
+		static void Rotate(const PxQuat& q, const PxVec3* in, PxVec3* out, PxU32 count);
+		static void Transform(const PxTransform& t, const PxVec3* in, PxVec3* out, PxU32 count);
+		static void Multiply(const PxTransform& parent, const PxTransform* local, PxTransform* out, PxU32 count);
+		static void ToMatrices(const PxTransform* t, PxMat44* out, PxU32 count);
+
+		// Smooth vertex normals for a quad mesh, each the normalised sum of the (c - a) x (b - a) normals of the quads around
+		// it. Points and normals are 16 bytes wide so that SSE handles a whole vector at once, the points' w is ignored.
+		static void QuadNormals(const PxVec4* points, PxU32 count, const PxU32* quads, PxU32 quadCount, PxVec4* normals);
 };
 
 class IO
@@ -0,0 +1,107 @@
+#ifndef profiler_h
+#define profiler_h
+
+#include <chrono>
+#include <vector>
+
+/// <summary>
+/// A lightweight wall-clock timer, reporting elapsed time in milliseconds since construction or the last call to Start.
+/// </summary>
+class Stopwatch
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	private:
+		Clock::time_point _start;
+
+	public:
+		Stopwatch() { Start(); }
+
+		void Start() { _start = Clock::now(); }
+		double Elapsed() const { return std::chrono::duration<double, std::milli>(Clock::now() - _start).count(); }
+
+		// Current wall-clock time in microseconds, used for timestamping events.
+		static unsigned long long Microseconds()
+		{
+			return (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+		}
+};
+
+/// <summary>
+/// Accumulates timing samples (in milliseconds) for a single measured section of code.
+/// </summary>
+class ProfileCounter
+{
+	private:
+		double _total = 0.0;
+		double _max = 0.0;
+		unsigned int _samples = 0;
+
+	public:
+		void Add(double ms)
+		{
+			// Accumulate the sample and track the worst case seen since the last reset.
+			_total += ms;
+			_samples++;
+			if (ms > _max)
+				_max = ms;
+		}
+
+		void Reset()
+		{
+			_total = _max = 0.0;
+			_samples = 0;
+		}
+
+		double Total() const { return _total; }
+		double Max() const { return _max; }
+		double Average() const { return _samples ? _total / _samples : 0.0; }
+		unsigned int Samples() const { return _samples; }
+};
+
+/// <summary>
+/// Counts timing samples (in milliseconds) in fixed-width buckets, samples beyond the last bucket are counted in it.
+/// </summary>
+class Histogram
+{
+	private:
+		std::vector<unsigned int> _buckets;
+		double _width;
+		ProfileCounter _counter;
+
+	public:
+		Histogram(double width = 1.0, unsigned int buckets = 100) : _buckets(buckets, 0), _width(width) { }
+
+		void Add(double ms)
+		{
+			unsigned int bucket = (ms > 0.0) ? (unsigned int)(ms / _width) : 0;
+			_buckets[bucket < _buckets.size() ? bucket : _buckets.size() - 1]++;
+			_counter.Add(ms);
+		}
+
+		void Reset()
+		{
+			for (unsigned int i = 0; i < _buckets.size(); i++)
+				_buckets[i] = 0;
+			_counter.Reset();
+		}
+
+		double Percentile(double q) const
+		{
+			// Upper edge of the bucket holding the q-th sample, so this never understates.
+			unsigned int target = (unsigned int)(q * _counter.Samples() + .5), seen = 0;
+			for (unsigned int i = 0; i < _buckets.size(); i++)
+				if ((seen += _buckets[i]) >= target && seen)
+					return (i + 1) * _width;
+			return 0.0;
+		}
+
+		unsigned int Bucket(unsigned int index) const { return _buckets[index]; }
+		unsigned int Buckets() const { return (unsigned int)_buckets.size(); }
+		double Width() const { return _width; }
+		unsigned int Samples() const { return _counter.Samples(); }
+		double Average() const { return _counter.Average(); }
+		double Max() const { return _counter.Max(); }
+};
+
+#endif
\ No newline at end of file
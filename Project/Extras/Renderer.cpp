@@ -1,7 +1,11 @@
 #include "Renderer.h"
 #include <iostream>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <cstring>
 #include "UserData.h"
+#include "Helper.h"
 
 using namespace std;
 
@@ -95,32 +99,195 @@ namespace VisualDebugger
 			}
 		}
 
-		void DrawTriangleMesh(const PxGeometryHolder& geometry)
+		// Vertex, normal and index arrays for a triangle mesh, built on the first draw and reused every frame after.
+		struct MeshBuffers
+		{
+			std::vector<PxVec3> verts;
+			std::vector<PxVec3> normals;
+			std::vector<PxU16> indices16;
+			std::vector<PxU32> indices32;
+		};
+
+		std::map<const PxTriangleMesh*, MeshBuffers> mesh_cache;
+
+		// Faces meeting at a sharper angle than this keep separate normals along their shared edge.
+		const PxReal crease_cos = .866f;
+
+		template <typename Index>
+		void BuildMeshBuffers(const PxTriangleMesh* mesh, const Index* trigs, MeshBuffers& buffers)
 		{
-			PxTriangleMesh* mesh = geometry.triangleMesh().triangleMesh;
 			const PxVec3* verts = mesh->getVertices();
-			PxU16* trigs = (PxU16*)mesh->getTriangles();
+			const PxU32 num_verts = mesh->getNbVertices();
 			const PxU32 num_trigs = mesh->getNbTriangles();
 
+			// Every corner of a mesh vertex whose face is within the crease angle of one already seen shares its render vertex,
+			// so curved walls are shaded smoothly while boxy walls and baked tables keep flat faces and hard edges. Each render
+			// vertex normal is the area weighted sum of the faces sharing it.
+			const PxU32 none = 0xFFFFFFFF;
+			std::vector<PxU32> first(num_verts, none);		// First render vertex split from each mesh vertex.
+			std::vector<PxU32> next;						// Next render vertex split from the same mesh vertex.
+			std::vector<PxVec3> faces;						// Unit normal of the face which created each render vertex.
+			std::vector<PxU32> indices(num_trigs*3);
+
+			buffers.verts.clear();
+			buffers.normals.clear();
 			for (PxU32 i = 0; i < num_trigs*3; i+=3)
 			{
-				PxVec3 v0 = verts[trigs[i]];
-				PxVec3 v1 = verts[trigs[i+1]];
-				PxVec3 v2 = verts[trigs[i+2]];
-				PxVec3 n = (v1-v0).cross(v2-v0);
-				n.normalize();
-				glBegin(GL_POLYGON);
-				glNormal3f(n.x, n.y, n.z);
-				glVertex3f(v0.x, v0.y, v0.z);
-				glVertex3f(v1.x, v1.y, v1.z);
-				glVertex3f(v2.x, v2.y, v2.z);
-				glEnd();
+				PxVec3 n = (verts[trigs[i+1]]-verts[trigs[i]]).cross(verts[trigs[i+2]]-verts[trigs[i]]);
+				PxVec3 unit = n.getNormalized();
+
+				for (PxU32 k = 0; k < 3; k++)
+				{
+					PxU32 v = trigs[i+k];
+					PxU32 out = first[v];
+					while (out != none && faces[out].dot(unit) < crease_cos)
+						out = next[out];
+
+					if (out == none)
+					{
+						out = (PxU32)buffers.verts.size();
+						buffers.verts.push_back(verts[v]);
+						buffers.normals.push_back(PxVec3(0.f));
+						faces.push_back(unit);
+						next.push_back(first[v]);
+						first[v] = out;
+					}
+
+					buffers.normals[out] += n;
+					indices[i+k] = out;
+				}
 			}
+
+			for (PxU32 i = 0; i < buffers.normals.size(); i++)
+				buffers.normals[i].normalizeSafe();
+
+			// Splitting can push a mesh past the 16 bit range, so the index size follows the render vertex count.
+			buffers.indices16.clear();
+			buffers.indices32.clear();
+			if (buffers.verts.size() <= 0xFFFF)
+				buffers.indices16.assign(indices.begin(), indices.end());
+			else
+				buffers.indices32.swap(indices);
+		}
+
+		const MeshBuffers& GetMeshBuffers(const PxTriangleMesh* mesh)
+		{
+			std::map<const PxTriangleMesh*, MeshBuffers>::iterator it = mesh_cache.find(mesh);
+			if (it != mesh_cache.end())
+				return it->second;
+
+			// Cooked meshes store 16 bit indices whenever the vertex count allows it, so the flag must be checked.
+			MeshBuffers& buffers = mesh_cache[mesh];
+#if PX_PHYSICS_VERSION_MAJOR > 3 || (PX_PHYSICS_VERSION_MAJOR == 3 && PX_PHYSICS_VERSION_MINOR >= 4)
+			if (mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::e16_BIT_INDICES)
+#else
+			if (mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::eHAS_16BIT_TRIANGLE_INDICES)
+#endif
+				BuildMeshBuffers(mesh, (const PxU16*)mesh->getTriangles(), buffers);
+			else
+				BuildMeshBuffers(mesh, (const PxU32*)mesh->getTriangles(), buffers);
+
+			return buffers;
+		}
+
+		void DrawTriangleMesh(const PxGeometryHolder& geometry)
+		{
+			const PxTriangleMeshGeometry& mesh_geometry = geometry.triangleMesh();
+			const MeshBuffers& buffers = GetMeshBuffers(mesh_geometry.triangleMesh);
+			if (buffers.verts.empty())
+				return;
+
+			if (!mesh_geometry.scale.isIdentity())
+			{
+				PxMat44 scale(mesh_geometry.scale.toMat33(), PxVec3(0.f));
+				glMultMatrixf((float*)&scale);
+			}
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &buffers.verts.front());
+			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &buffers.normals.front());
+
+			if (!buffers.indices16.empty())
+				glDrawElements(GL_TRIANGLES, (GLsizei)buffers.indices16.size(), GL_UNSIGNED_SHORT, &buffers.indices16.front());
+			else
+				glDrawElements(GL_TRIANGLES, (GLsizei)buffers.indices32.size(), GL_UNSIGNED_INT, &buffers.indices32.front());
+
+			glDisableClientState(GL_VERTEX_ARRAY);
+			glDisableClientState(GL_NORMAL_ARRAY);
+		}
+
+		// A height field's grid built once in the scale it was drawn with, rebuilt only if a shape uses it with a different scale.
+		struct HeightFieldBuffers : public MeshBuffers
+		{
+			PxVec3 scale;
+		};
+
+		std::map<const PxHeightField*, HeightFieldBuffers> height_field_cache;
+
+		void BuildHeightFieldBuffers(const PxHeightField* height_field, const PxVec3& scale, HeightFieldBuffers& buffers)
+		{
+			const PxU32 rows = height_field->getNbRows();
+			const PxU32 columns = height_field->getNbColumns();
+
+			std::vector<PxHeightFieldSample> samples(rows*columns);
+			height_field->saveCells(&samples.front(), (PxU32)(samples.size()*sizeof(PxHeightFieldSample)));
+
+			// One vertex per sample, rows along x and columns along z.
+			buffers.scale = scale;
+			buffers.verts.resize(rows*columns);
+			buffers.normals.assign(rows*columns, PxVec3(0.f));
+			for (PxU32 r = 0; r < rows; r++)
+				for (PxU32 c = 0; c < columns; c++)
+					buffers.verts[r*columns+c] = PxVec3(r*scale.x, samples[r*columns+c].height*scale.y, c*scale.z);
+
+			// Two triangles per cell, split along the same diagonal as the collision geometry, facing up the y axis.
+			buffers.indices32.clear();
+			buffers.indices32.reserve((rows-1)*(columns-1)*6);
+			for (PxU32 r = 0; r < rows-1; r++)
+			{
+				for (PxU32 c = 0; c < columns-1; c++)
+				{
+					PxU32 v00 = r*columns+c, v01 = v00+1, v10 = v00+columns, v11 = v10+1;
+					PxU32 cell[6] = { v00, v01, v11, v00, v11, v10 };
+					if (!samples[v00].tessFlag())
+					{
+						PxU32 other[6] = { v00, v01, v10, v01, v11, v10 };
+						std::copy(other, other+6, cell);
+					}
+					buffers.indices32.insert(buffers.indices32.end(), cell, cell+6);
+				}
+			}
+
+			// Smooth shading, each vertex normal is the area weighted sum of the faces around it.
+			for (PxU32 i = 0; i < buffers.indices32.size(); i+=3)
+			{
+				PxU32 a = buffers.indices32[i], b = buffers.indices32[i+1], c = buffers.indices32[i+2];
+				PxVec3 n = (buffers.verts[b]-buffers.verts[a]).cross(buffers.verts[c]-buffers.verts[a]);
+				buffers.normals[a] += n;
+				buffers.normals[b] += n;
+				buffers.normals[c] += n;
+			}
+			for (PxU32 i = 0; i < buffers.normals.size(); i++)
+				buffers.normals[i].normalizeSafe();
 		}
 
 		void DrawHeightField(const PxGeometryHolder& geometry)
 		{
-			
+			const PxHeightFieldGeometry& hf_geometry = geometry.heightField();
+			PxVec3 scale(hf_geometry.rowScale, hf_geometry.heightScale, hf_geometry.columnScale);
+
+			HeightFieldBuffers& buffers = height_field_cache[hf_geometry.heightField];
+			if (buffers.verts.empty() || buffers.scale != scale)
+				BuildHeightFieldBuffers(hf_geometry.heightField, scale, buffers);
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &buffers.verts.front());
+			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &buffers.normals.front());
+			glDrawElements(GL_TRIANGLES, (GLsizei)buffers.indices32.size(), GL_UNSIGNED_INT, &buffers.indices32.front());
+			glDisableClientState(GL_VERTEX_ARRAY);
+			glDisableClientState(GL_NORMAL_ARRAY);
 		}
 
 		void RenderGeometry(const PxGeometryHolder& geometry)
@@ -153,6 +320,15 @@ namespace VisualDebugger
 			}
 		}
 
+		// Particle copies and normals for a cloth, kept between frames and only resized when its particle count changes.
+		struct ClothBuffers
+		{
+			std::vector<PxClothParticle> particles;
+			std::vector<PxVec4> normals;
+		};
+
+		std::map<const PxCloth*, ClothBuffers> cloth_cache;
+
 		void RenderCloth(const PxCloth* cloth)
 		{
 			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
@@ -161,35 +337,27 @@ namespace VisualDebugger
 			PxU32 quad_count = mesh_desc->quads.count;
 			PxU32* quads = (PxU32*)mesh_desc->quads.data;
 
-			std::vector<PxVec3> verts(cloth->getNbParticles());
-			std::vector<PxVec3> norms(verts.size(), PxVec3(0.f,0.f,0.f));
+			ClothBuffers& buffers = cloth_cache[cloth];
+			PxU32 particle_count = cloth->getNbParticles();
+			if (buffers.particles.size() != particle_count)
+			{
+				buffers.particles.resize(particle_count);
+				buffers.normals.resize(particle_count);
+			}
 
-			cloth->lockParticleData();
+			if (!particle_count)
+				return;
 
+			// Hold the lock only for as long as it takes to copy the particles out.
 			PxClothParticleData* particle_data = cloth->lockParticleData();
 			if (!particle_data)
 				return;
 
-			for (PxU32 j = 0; j < verts.size(); j++)
-				verts[j] = particle_data->particles[j].pos;
-
+			memcpy(&buffers.particles.front(), particle_data->particles, particle_count*sizeof(PxClothParticle));
 			particle_data->unlock();
 
-			for (PxU32 i = 0; i < quad_count*4; i+=4)
-			{
-				PxVec3 v0 = verts[quads[i]];
-				PxVec3 v1 = verts[quads[i+1]];
-				PxVec3 v2 = verts[quads[i+2]];
-				PxVec3 n = -((v1-v0).cross(v2-v0));
-
-				norms[quads[i]] += n;
-				norms[quads[i+1]] += n;
-				norms[quads[i+2]] += n;
-				norms[quads[i+3]] += n;
-			}
-
-			for (PxU32 i = 0; i < norms.size(); i++)
-				norms[i].normalize();
+			// A cloth particle is its position followed by its inverse weight, so the particles are read as PxVec4s.
+			Mathv::QuadNormals((const PxVec4*)&buffers.particles.front(), particle_count, quads, quad_count, &buffers.normals.front());
 
 			PxTransform pose = cloth->getGlobalPose();
 			PxMat44 shapePose(pose);
@@ -202,8 +370,8 @@ namespace VisualDebugger
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glEnableClientState(GL_NORMAL_ARRAY);
 
-			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &verts.front());
-			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &norms.front());
+			glVertexPointer(3, GL_FLOAT, sizeof(PxClothParticle), &buffers.particles.front().pos);
+			glNormalPointer(GL_FLOAT, sizeof(PxVec4), &buffers.normals.front());
 
 			glDrawElements(GL_QUADS, quad_count*4, GL_UNSIGNED_INT, quads);
 
@@ -279,9 +447,104 @@ namespace VisualDebugger
 			background_color = color;
 		}
 
+		void ReleaseMeshCache()
+		{
+			mesh_cache.clear();
+			height_field_cache.clear();
+			cloth_cache.clear();
+		}
+
+		// Per-actor scratch space for the shape matrices, reused across actors and frames.
+		std::vector<PxShape*> render_shapes;
+		std::vector<PxTransform> render_poses;
+		std::vector<PxMat44> render_matrices;
+
+		// Colour of the shadows, taken from the ground plane as it is drawn.
+		PxVec3 shadow_color;
+
+		void Render(PxRigidActor* rigid_actor, const PxTransform& pose)
+		{
+			// Gather the visible shapes' local poses and turn them into render matrices for the whole actor at once.
+			render_shapes.resize(rigid_actor->getNbShapes());
+			if (render_shapes.empty())
+				return;
+			rigid_actor->getShapes(&render_shapes.front(), (PxU32)render_shapes.size());
+
+			PxU32 visible = 0;
+			for (PxU32 j = 0; j < render_shapes.size(); j++)
+				if (render_shapes[j]->getFlags().isSet(PxShapeFlag::eVISUALIZATION))
+					render_shapes[visible++] = render_shapes[j];
+			if (!visible)
+				return;
+
+			render_poses.resize(visible);
+			render_matrices.resize(visible);
+			for (PxU32 j = 0; j < visible; j++)
+				render_poses[j] = render_shapes[j]->getLocalPose();
+			Mathv::Multiply(pose, &render_poses.front(), &render_poses.front(), visible);
+
+			for (PxU32 j = 0; j < visible; j++)
+			{
+				if (render_shapes[j]->getGeometryType() == PxGeometryType::ePLANE)
+				{
+					render_poses[j].q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
+					render_poses[j].p += PxVec3(0, -0.01, 0);
+				}
+			}
+			Mathv::ToMatrices(&render_poses.front(), &render_matrices.front(), visible);
+
+			for(PxU32 j = 0; j < visible; j++)
+			{
+				const PxShape* shape = render_shapes[j];
+
+				PxGeometryHolder h = shape->getGeometry();
+				PxMat44& shapePose = render_matrices[j];
+				// render object
+				glPushMatrix();
+				glMultMatrixf((float*)&shapePose);
+
+				PxVec3 shape_color = default_color;
+
+				if (shape->userData)
+				{
+					shape_color = *(((UserData*)shape->userData)->color);
+					if (h.getType() == PxGeometryType::ePLANE)
+					{
+						shadow_color = shape_color*0.9;
+					}
+				}
+
+				if (h.getType() == PxGeometryType::ePLANE)
+					glDisable(GL_LIGHTING);
+
+				glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
+
+				RenderGeometry(h);
+
+				if (h.getType() == PxGeometryType::ePLANE)
+					glEnable(GL_LIGHTING);
+
+				glPopMatrix();
+
+				if (show_shadows && (h.getType() != PxGeometryType::ePLANE))
+				{
+					const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
+					const PxReal shadowMat[] = { 1,0,0,0, -shadowDir.x / shadowDir.y,0,-shadowDir.z / shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
+					glPushMatrix();
+					glMultMatrixf(shadowMat);
+					glMultMatrixf((float*)&shapePose);
+					glDisable(GL_LIGHTING);
+					glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
+					RenderGeometry(h);
+					glEnable(GL_LIGHTING);
+					glPopMatrix();
+				}
+			}
+		}
+
 		void Render(PxActor** actors, const PxU32 numActors)
 		{
-			PxVec3 shadow_color = default_color*0.9;
+			shadow_color = default_color*0.9;
 			for(PxU32 i=0;i<numActors;i++)
 			{
 				if (actors[i]->isCloth())
@@ -291,68 +554,8 @@ namespace VisualDebugger
 				else if (actors[i]->isRigidActor())
 				{
 					PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
-					std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
-					rigid_actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
-
-					for(PxU32 j = 0; j < shapes.size(); j++)
-					{
-						const PxShape* shape = shapes[j];
-
-						if (shape->getFlags().isSet(PxShapeFlag::eVISUALIZATION))
-						{
-							PxTransform pose = PxShapeExt::getGlobalPose(*shape, *shape->getActor());
-							PxGeometryHolder h = shape->getGeometry();
-							if (h.getType() == PxGeometryType::ePLANE)
-							{
-								pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
-								pose.p += PxVec3(0, -0.01, 0);
-							}
-
-							PxMat44 shapePose(pose);
-							// render object
-							glPushMatrix();
-							glMultMatrixf((float*)&shapePose);
-
-							PxVec3 shape_color = default_color;
-
-							if (shape->userData)
-							{
-								shape_color = *(((UserData*)shape->userData)->color);
-								if (h.getType() == PxGeometryType::ePLANE)
-								{
-									shadow_color = shape_color*0.9;
-								}
-							}
-
-							if (h.getType() == PxGeometryType::ePLANE)
-								glDisable(GL_LIGHTING);
-
-							glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
-
-							RenderGeometry(h);
-
-							if (h.getType() == PxGeometryType::ePLANE)
-								glEnable(GL_LIGHTING);
-
-							glPopMatrix();
-
-							if (show_shadows && (h.getType() != PxGeometryType::ePLANE))
-							{
-								const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
-								const PxReal shadowMat[] = { 1,0,0,0, -shadowDir.x / shadowDir.y,0,-shadowDir.z / shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
-								glPushMatrix();
-								glMultMatrixf(shadowMat);
-								glMultMatrixf((float*)&shapePose);
-								glDisable(GL_LIGHTING);
-								glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
-								RenderGeometry(h);
-								glEnable(GL_LIGHTING);
-								glPopMatrix();
-							}
-						}
-					}
+					Render(rigid_actor, rigid_actor->getGlobalPose());
 				}
-
 			}
 		}
 
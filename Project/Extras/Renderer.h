@@ -20,6 +20,9 @@ namespace VisualDebugger
 
 		void Render(PxActor** actors, const PxU32 numActors);
 
+		// Draw a single actor at the given pose rather than its simulated one, e.g. a pose latched just before Finish.
+		void Render(PxRigidActor* actor, const PxTransform& pose);
+
 		void Render(const PxRenderBuffer& data, PxReal line_width=1.f);
 
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
@@ -34,6 +37,10 @@ namespace VisualDebugger
 		void ShowShadows(bool value);
 
 		bool ShowShadows();
+
+		// Drop the cached render buffers of every triangle mesh, height field and cloth, needed before a drawn mesh or cloth is
+		// released and its address reused.
+		void ReleaseMeshCache();
 	}
 }
 
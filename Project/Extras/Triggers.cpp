@@ -1,9 +1,10 @@
-#include "Triggers.h";
+#include "Triggers.h"
 
 void SimulationCallback::onTrigger(PxTriggerPair* pairs, PxU32 count)
 {
 	// Core callback functionality for trigger collisions, this remains unchanged in child classes which simply override the
 	// event_ functions. Check each actor within the given pair ...
+	Stopwatch timer;
 	for (PxU32 i = 0; i < count; i++)
 	{
 		if (pairs[i].otherShape->getGeometryType() != PxGeometryType::ePLANE)
@@ -17,43 +18,94 @@ void SimulationCallback::onTrigger(PxTriggerPair* pairs, PxU32 count)
 				event_TriggerLost(pairs[i].otherShape, pairs[i].triggerShape);
 		}
 	}
+	callbackTime.Add(timer.Elapsed());
+}
+
+PxReal SimulationCallback::Impulse(const PxContactPair& pair)
+{
+	// Sum the impulse applied at each contact point, this is only available when contact points are requested.
+	PxContactPairPoint points[16];
+	PxU32 count = pair.extractContacts(points, 16);
+
+	PxReal impulse = 0.f;
+	for (PxU32 i = 0; i < count; i++)
+		impulse += points[i].impulse.magnitude();
+
+	return impulse;
 }
 
 void SimulationCallback::onContact(const PxContactPairHeader &pairHeader, const PxContactPair *pairs, PxU32 nbPairs)
 {
 	// Core callback functionality for trigger collisions, this remains unchanged in child classes which simply override the
 	// event_ functions. Check each actor within the given pair ...
+	Stopwatch timer;
 	for (PxU32 i = 0; i < nbPairs; i++)
 	{
-		// If contact occurs, execute the virtual void event_ContactFound.
-		if (pairs[i].events & PxPairFlag::eNOTIFY_TOUCH_FOUND)
-			event_ContactFound(pairs[i].shapes, 2);
+		// Pairs whose shapes have since been removed from the scene can no longer be queried.
+		if (pairs[i].flags & (PxContactPairFlag::eREMOVED_SHAPE_0 | PxContactPairFlag::eREMOVED_SHAPE_1))
+			continue;
+
+		// If contact occurs, execute the virtual void event_ContactFound. The total impulse of the contact is only extracted
+		// when asked for and contact points were requested, otherwise it is left at zero.
+		if (pairs[i].events & (PxPairFlag::eNOTIFY_TOUCH_FOUND | PxPairFlag::eNOTIFY_THRESHOLD_FORCE_FOUND))
+			event_ContactFound(pairs[i].shapes, 2, (contactImpulses && pairs[i].contactCount) ? Impulse(pairs[i]) : 0.f);
 
 		// If contact is lost, execute the virtual void event_ContactLost.
 		if (pairs[i].events & PxPairFlag::eNOTIFY_TOUCH_LOST)
 			event_ContactLost(pairs[i].shapes, 2);
 	}
+	callbackTime.Add(timer.Elapsed());
 }
 
-void CustomSimulationCallback::event_TriggerFound(PxShape* shape, PxShape* trigger)
+CustomSimulationCallback::CustomSimulationCallback(PxU32 debounceSteps)
+	: SimulationCallback(), _debounceSteps(debounceSteps)
 {
-	// If the player (PLAYER) hits ...
-	if (shape->getSimulationFilterData().word0 == FilterGroup::PLAYER)
+	for (PxU32 i = 0; i < DEBOUNCE_TABLE_SIZE; i++)
+		_recent[i].shapes[0] = _recent[i].shapes[1] = nullptr;
+}
+
+bool CustomSimulationCallback::Debounce(PxShape* shape0, PxShape* shape1)
+{
+	// Returns true if this pair was already reported within the debounce window, otherwise stamps it with this step.
+	PxU32 step = Game::Instance().step();
+	size_t key = ((size_t)shape0 >> 4) * 31 + ((size_t)shape1 >> 4);
+	PairStamp& stamp = _recent[key % DEBOUNCE_TABLE_SIZE];
+
+	if (stamp.shapes[0] == shape0 && stamp.shapes[1] == shape1 && step - stamp.step <= _debounceSteps)
 	{
-		switch (trigger->getSimulationFilterData().word0)
-		{
-			case FilterGroup::SCOREZONE:
-					// ... a score zone. Increment the gamestate score by 200.
-					Game::Instance().score(200);
-					break;
-				case FilterGroup::KILLZONE:
-					// ... a kill zone. Decrement the gamestate lives by 1.
-					Game::Instance().lives(-1);
-					break;
-				default:
-					break;
-		}
+		debounced++;
+		return true;
 	}
+
+	stamp.shapes[0] = shape0;
+	stamp.shapes[1] = shape1;
+	stamp.step = step;
+	return false;
+}
+
+void CustomSimulationCallback::Queue(GameEvent::Type type, PxShape* shape0, const PxFilterData& filter0, PxShape* shape1, const PxFilterData& filter1, PxReal impulse)
+{
+	// Record the event for the game to process once the step has finished. No game logic runs inside the callback, this
+	// is limited to a handful of stores into the preallocated event queue.
+	GameEvent e;
+	e.type = type;
+	e.step = Game::Instance().step();
+	e.shapes[0] = shape0;
+	e.shapes[1] = shape1;
+	e.filters[0] = filter0;
+	e.filters[1] = filter1;
+	e.impulse = impulse;
+	e.timestamp = Stopwatch::Microseconds();
+
+	Game::Instance().events().Push(e);
+}
+
+void CustomSimulationCallback::event_TriggerFound(PxShape* shape, PxShape* trigger)
+{
+	// Only the player (PLAYER) entering a trigger is of interest to the game.
+	PxFilterData filter = shape->getSimulationFilterData();
+	if (filter.word0 == FilterGroup::PLAYER)
+		Queue(GameEvent::TRIGGER_FOUND, shape, filter, trigger, trigger->getSimulationFilterData(), 0.f);
 }
 
 void CustomSimulationCallback::event_TriggerLost(PxShape* shape, PxShape* trigger)
@@ -61,24 +113,28 @@ void CustomSimulationCallback::event_TriggerLost(PxShape* shape, PxShape* trigge
 	
 }
 
-void CustomSimulationCallback::event_ContactFound(PxShape* const* shapes, const int size)
+void CustomSimulationCallback::event_ContactFound(PxShape* const* shapes, const int size, PxReal impulse)
 {
-	// If the player (PLAYER) hits ...
-	if (shapes[1]->getSimulationFilterData().word0 == FilterGroup::PLAYER)
-	{
-		switch (shapes[0]->getSimulationFilterData().word0)
-		{
-			case FilterGroup::HITPOINT:
-				// ... a hitpoint. Increment the gamestate score by 100.
-				Game::Instance().score(100);
-				break;
-			default:
-				break;
-		}
-	}
+	// If the player (PLAYER) hits something, queue the contact with the player shape first. Filter data is read once per
+	// shape and passed along, rather than queried again when the event is queued.
+	PxFilterData filters[2] = { shapes[0]->getSimulationFilterData(), shapes[1]->getSimulationFilterData() };
+	int player = (filters[1].word0 == FilterGroup::PLAYER) ? 1 : (filters[0].word0 == FilterGroup::PLAYER) ? 0 : -1;
+	if (player < 0)
+		return;
+
+	if (_debounceSteps && Debounce(shapes[player], shapes[1 - player]))
+		return;
+
+	Queue(GameEvent::CONTACT_FOUND, shapes[player], filters[player], shapes[1 - player], filters[1 - player], impulse);
 }
 
 void CustomSimulationCallback::event_ContactLost(PxShape* const* shapes, const int size)
 {
-	
+	// Lost contacts are only reported in full mode, where they keep per-ball contact counts (e.g. telemetry) balanced. In
+	// minimal mode Telemetry::Writer counts the contacts found each step instead, see Writer::LostContacts.
+	PxFilterData filters[2] = { shapes[0]->getSimulationFilterData(), shapes[1]->getSimulationFilterData() };
+	if (filters[1].word0 == FilterGroup::PLAYER)
+		Queue(GameEvent::CONTACT_LOST, shapes[1], filters[1], shapes[0], filters[0], 0.f);
+	else if (filters[0].word0 == FilterGroup::PLAYER)
+		Queue(GameEvent::CONTACT_LOST, shapes[0], filters[0], shapes[1], filters[1], 0.f);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <iostream>
 #include "PxPhysicsAPI.h"
 #include "../Game.h"
+#include "Profiler.h"
 
 using namespace physx;
 
@@ -18,33 +19,86 @@ struct FilterGroup
 	};
 };
 
+// How much contact information is requested from PhysX for pairs which the game is notified about. This is turned into
+// the filter shader's constant block, so it takes effect when the scene is created. Scoring only needs the first touch,
+// so minimal is the default and full is only asked for by something which needs more, e.g. telemetry's contact counts.
+struct ContactReporting
+{
+	enum Mode : PxU32
+	{
+		FULL,			// Touch found and lost with contact points.
+		MINIMAL			// Touch found only (or threshold force found), no contact points are generated or extracted.
+	};
+
+	PxU32 mode;
+	PxReal forceThreshold;		// Minimal mode only reports touches above this normal force (N) when it is above zero.
+	PxU32 debounceSteps;		// A pair which touched within this many steps is not reported again.
+
+	ContactReporting(PxU32 _mode = MINIMAL, PxReal _forceThreshold = 0.f, PxU32 _debounceSteps = 0)
+		: mode(_mode), forceThreshold(_forceThreshold), debounceSteps(_debounceSteps) { }
+};
+
 class SimulationCallback : public PxSimulationEventCallback
 {
+	protected:
+		static PxReal Impulse(const PxContactPair& pair);
+
 	public:
+		// Time spent inside onTrigger and onContact, this is used to measure callback cost under load.
+		ProfileCounter callbackTime;
+
+		// Total number of actors which have woken up or fallen asleep, as reported at the end of each step.
+		PxU32 wakeCount = 0;
+		PxU32 sleepCount = 0;
+
+		// Sum the impulse of each reported contact into the event. This extracts every contact point inside the callback, so
+		// it is off unless something reads the impulse, and only has an effect when contact points are requested.
+		bool contactImpulses = false;
+
 		SimulationCallback() { }
 
 		// This behaviour remains constant in child classes.
 		void onTrigger(PxTriggerPair* pairs, PxU32 count);
 		void onContact(const PxContactPairHeader &pairHeader, const PxContactPair *pairs, PxU32 nbPairs);
 		void onConstraintBreak(PxConstraintInfo *constraints, PxU32 count) { }
-		void onWake(PxActor **actors, PxU32 count) { }
-		void onSleep(PxActor **actors, PxU32 count) { }
+		void onWake(PxActor **actors, PxU32 count) { wakeCount += count; }
+		void onSleep(PxActor **actors, PxU32 count) { sleepCount += count; }
 
 		// This functionality is changed in child classes.
 		virtual void event_TriggerFound(PxShape* shape, PxShape* trigger) { }
 		virtual void event_TriggerLost(PxShape* shape, PxShape* trigger) { }
-		virtual void event_ContactFound(PxShape* const* shapes, const int size) { }
+		virtual void event_ContactFound(PxShape* const* shapes, const int size, PxReal impulse) { }
 		virtual void event_ContactLost(PxShape* const* shapes, const int size) { }
 };
 
 class CustomSimulationCallback : public SimulationCallback
 {
+	// The last step at which a pair of shapes was reported, kept in a small direct-mapped table. A collision in the table
+	// only means a repeat touch may occasionally be reported, never that a new one is lost.
+	struct PairStamp
+	{
+		PxShape* shapes[2];
+		PxU32 step;
+	};
+
+	static const PxU32 DEBOUNCE_TABLE_SIZE = 256;
+
+	private:
+		PxU32 _debounceSteps = 0;
+		PairStamp _recent[DEBOUNCE_TABLE_SIZE];
+
+		void Queue(GameEvent::Type type, PxShape* shape0, const PxFilterData& filter0, PxShape* shape1, const PxFilterData& filter1, PxReal impulse);
+		bool Debounce(PxShape* shape0, PxShape* shape1);
+
 	public:
-		CustomSimulationCallback() : SimulationCallback() { }
+		// Number of touches which were dropped for repeating within the debounce window.
+		PxU32 debounced = 0;
+
+		CustomSimulationCallback(PxU32 debounceSteps = 0);
 
 		void event_TriggerFound(PxShape* shape, PxShape* trigger) override;
 		void event_TriggerLost(PxShape* shape, PxShape* trigger) override;
-		void event_ContactFound(PxShape* const* shapes, const int size) override;
+		void event_ContactFound(PxShape* const* shapes, const int size, PxReal impulse) override;
 		void event_ContactLost(PxShape* const* shapes, const int size) override;
 };
 
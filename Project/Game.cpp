@@ -1,4 +1,7 @@
 #include "Game.h"
+#include "Extras/Triggers.h"
+#include "Multiball.h"
+#include "Telemetry.h"
 
 Game* Game::_instance = nullptr;
 
@@ -16,19 +19,21 @@ int Game::score()
 
 void Game::score(int modifier)
 {
-	// Add modifier * multiplier to the score and increment the multiplier if the score is a factor of 5.
+	// Add modifier * multiplier to the score and raise the multiplier on every streak of scoring hits, by default every 5th.
 	_score += modifier * _multiplier;
-	_hud->EditLine(VisualDebugger::SCORE, 3, _score);
+	if (_hud)
+		_hud->EditLine(VisualDebugger::SCORE, 3, _score);
 
-	if (++_streak % 5 == 0)
-		_multiplier++;
+	if (_rules.StreakHits() && ++_streak % _rules.StreakHits() == 0)
+		_multiplier += _rules.StreakMultiplier();
 }
 
 void Game::lives(int modifier)
 {
 	// Modify the lives parameter by the given value and check necessary states.
 	_lives += modifier;
-	_hud->EditLine(VisualDebugger::SCORE, 1, _lives);
+	if (_hud)
+		_hud->EditLine(VisualDebugger::SCORE, 1, _lives);
 
 	// Toggles a trigger for resetting player position at the end of a physics simulation.
 	ResetPlayer();
@@ -40,6 +45,16 @@ bool Game::gameover()
 	return _gameOver;
 }
 
+physx::PxU32 Game::games()
+{
+	return _games;
+}
+
+int Game::finalScore()
+{
+	return _finalScore;
+}
+
 void Game::player(physx::PxActor* player)
 {
 	// Set the player references to that of the provided value if its type is valid (rigid actor).
@@ -61,7 +76,130 @@ void Game::hud(VisualDebugger::HUD* hud)
 	_hud->EditLine(VisualDebugger::SCORE, 3, _score);
 }
 
-void Game::Reset()
+void Game::multiball(Multiball* multiball)
+{
+	// Attach the multiball pool so that events from pooled balls can be attributed to them.
+	_multiball = multiball;
+}
+
+void Game::telemetry(Telemetry::Writer* telemetry)
+{
+	// Attach a telemetry stream, which is told about every event so that it can track contacts and zones per ball.
+	_telemetry = telemetry;
+}
+
+EventQueue& Game::events()
+{
+	return _events;
+}
+
+physx::PxU32 Game::eventCount(GameEvent::Type type)
+{
+	return _eventCounts[type];
+}
+
+physx::PxU32 Game::step()
+{
+	return _step;
+}
+
+ScoringRules& Game::rules()
+{
+	return _rules;
+}
+
+bool Game::rules(const std::string& path)
+{
+	// Load the scoring rules from a file, before the scene is created as its triggers and hitpoints are tagged with rule ids.
+	if (!_rules.Load(path))
+		return false;
+
+	_ruleStates.assign(_rules.Count(), ScoringRules::RuleState());
+	_mode = 0;
+	_modeEnds = 0;
+	return true;
+}
+
+physx::PxU32 Game::mode()
+{
+	return _mode;
+}
+
+void Game::Process(const GameEvent& e)
+{
+	// Apply the game rules to a single event. The event queue only contains events where filters[0] is the player.
+	_eventCounts[e.type]++;
+
+	if (_telemetry)
+		_telemetry->Event(e);
+
+	// The shape which was hit or entered carries its rule id in word3, the rule for it in the current mode is a single
+	// table lookup. Shapes without a rule, e.g. walls, have an id of 0 which no rule uses.
+	physx::PxU32 index = _rules.Lookup(_mode, e.filters[1].word3);
+	if (index == ScoringRules::NO_RULE || _rules.Get(index).event != e.type)
+		return;
+
+	// Balls belonging to the multiball pool are attributed to their own slot rather than the main player.
+	bool pooled = _multiball && Multiball::IsPooled(e.filters[0]);
+	Apply(index, pooled, Multiball::SlotFromFilter(e.filters[0]));
+}
+
+void Game::Award(int points, bool pooled, physx::PxU32 slot)
+{
+	if (pooled)
+		_multiball->Score(slot, points);
+	else score(points);
+}
+
+void Game::Apply(physx::PxU32 index, bool pooled, physx::PxU32 slot)
+{
+	const ScoringRule& rule = _rules.Get(index);
+
+	if (rule.points)
+		Award(rule.points, pooled, slot);
+
+	_multiplier += rule.multiplier;
+
+	// Losing a life resets the player, or loses the ball if it is pooled. Extra lives always go to the player.
+	if (rule.lives < 0)
+	{
+		if (pooled)
+			_multiball->Lost(slot);
+		else lives(rule.lives);
+	}
+	else if (rule.lives > 0)
+	{
+		_lives += rule.lives;
+		if (_hud)
+			_hud->EditLine(VisualDebugger::SCORE, 1, _lives);
+	}
+
+	// A combo is counted from the first hit of the rule within its window, and starts over once the bonus is awarded.
+	if (rule.comboCount)
+	{
+		ScoringRules::RuleState& state = _ruleStates[index];
+		if (!state.comboHits || _step - state.comboStart > rule.comboSteps)
+		{
+			state.comboStart = _step;
+			state.comboHits = 0;
+		}
+
+		if (++state.comboHits >= rule.comboCount)
+		{
+			Award(rule.comboBonus, pooled, slot);
+			state.comboHits = 0;
+		}
+	}
+
+	if (rule.mode != ScoringRule::KEEP_MODE)
+	{
+		physx::PxU32 duration = _rules.GetMode(rule.mode).duration;
+		_mode = rule.mode;
+		_modeEnds = duration ? _step + duration : 0;
+	}
+}
+
+void Game::Reset(bool resetPlayer)
 {
 	// Reset all game state variables.
 	_multiplier = 1;
@@ -69,13 +207,75 @@ void Game::Reset()
 	_score = 0;
 	_lives = 5;
 	_gameOver = false;
+	_mode = 0;
+	_modeEnds = 0;
+	_ruleStates.assign(_rules.Count(), ScoringRules::RuleState());
 
-	// Update the game HUD to show the new reset variables.
-	_hud->EditLine(VisualDebugger::SCORE, 1, _lives);
-	_hud->EditLine(VisualDebugger::SCORE, 3, _score);
+	// Update the game HUD to show the new reset variables, headless runs have no HUD attached.
+	if (_hud)
+	{
+		_hud->EditLine(VisualDebugger::SCORE, 1, _lives);
+		_hud->EditLine(VisualDebugger::SCORE, 3, _score);
+	}
 
-	// Reset the player position at the end of the current simulation step.
-	ResetPlayer();
+	// Reset the player position at the end of the current simulation step. Otherwise the game is being restarted along
+	// with its scene (e.g. for a replay), so also discard anything left over from the previous one.
+	if (resetPlayer)
+	{
+		ResetPlayer();
+		return;
+	}
+
+	GameEvent e;
+	while (_events.Pop(e)) {}
+
+	_step = 0;
+	for (int i = 0; i < GameEvent::COUNT; i++)
+		_eventCounts[i] = 0;
+	_resetNextUpdate = false;
+}
+
+void Game::Save(State& state)
+{
+	state.multiplier = _multiplier;
+	state.streak = _streak;
+	state.score = _score;
+	state.lives = _lives;
+	state.gameOver = _gameOver;
+	state.resetNextUpdate = _resetNextUpdate;
+	state.step = _step;
+	for (int i = 0; i < GameEvent::COUNT; i++)
+		state.eventCounts[i] = _eventCounts[i];
+	state.mode = _mode;
+	state.modeEnds = _modeEnds;
+	state.games = _games;
+	state.finalScore = _finalScore;
+	state.ruleStates = _ruleStates;
+}
+
+void Game::Load(const State& state)
+{
+	// Restore a saved game, this is only valid between steps when the event queue is empty.
+	_multiplier = state.multiplier;
+	_streak = state.streak;
+	_score = state.score;
+	_lives = state.lives;
+	_gameOver = state.gameOver;
+	_resetNextUpdate = state.resetNextUpdate;
+	_step = state.step;
+	for (int i = 0; i < GameEvent::COUNT; i++)
+		_eventCounts[i] = state.eventCounts[i];
+	_mode = state.mode;
+	_modeEnds = state.modeEnds;
+	_games = state.games;
+	_finalScore = state.finalScore;
+	_ruleStates = state.ruleStates;
+
+	if (_hud)
+	{
+		_hud->EditLine(VisualDebugger::SCORE, 1, _lives);
+		_hud->EditLine(VisualDebugger::SCORE, 3, _score);
+	}
 }
 
 void Game::ResetPlayer()
@@ -85,9 +285,29 @@ void Game::ResetPlayer()
 
 void Game::Update()
 {
-	// Check if game over, and if it is... Reset the game.
+	// Apply the rules to the events queued by the simulation callbacks during the last step, straight from the queue. This
+	// is the only place that game rules are applied, so HUD edits and resets never happen mid-step.
+	GameEvent e;
+	while (_events.Pop(e))
+		Process(e);
+
+	_step++;
+
+	// A timed mode returns to the base mode once it runs out.
+	if (_modeEnds && _step >= _modeEnds)
+	{
+		_mode = 0;
+		_modeEnds = 0;
+	}
+
+	// Check if game over, and if it is... Reset the game. This happens within the step, so replays and rollback restart
+	// the game exactly when it was restarted originally.
 	if (_gameOver)
+	{
+		_finalScore = _score;
+		_games++;
 		Reset();
+	}
 
 	// This will only trigger when the player has been scheduled for a position reset, and will only be called on PostUpdate
 	// within the PhysicsEngine class.
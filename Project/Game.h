@@ -3,6 +3,11 @@
 
 #include "PxPhysicsAPI.h"
 #include "Extras/HUD.h"
+#include "Extras/EventQueue.h"
+#include "Rules.h"
+
+class Multiball;
+namespace Telemetry { class Writer; }
 
 class Game
 {
@@ -10,7 +15,7 @@ class Game
 	/// Private singleton members, this hides the constructor, destructor and copy constructor.
 	private:
 			static Game* _instance;
-			Game() { }
+			Game() : _events(4096) { _rules.Defaults(); _ruleStates.resize(_rules.Count()); }
 			Game(const Game* o) { }
 			~Game() { }
 	/// SINGLETON
@@ -27,6 +32,25 @@ class Game
 		}
 	/// SINGLETON
 
+	public:
+		// Every game variable which changes during play, used to roll the game back along with its scene.
+		struct State
+		{
+			int multiplier;
+			int streak;
+			int score;
+			int lives;
+			bool gameOver;
+			bool resetNextUpdate;
+			physx::PxU32 step;
+			physx::PxU32 eventCounts[GameEvent::COUNT];
+			physx::PxU32 mode;
+			physx::PxU32 modeEnds;
+			physx::PxU32 games;
+			int finalScore;
+			std::vector<ScoringRules::RuleState> ruleStates;
+		};
+
 	private:
 		int _multiplier = 1;
 		int _streak = 0;
@@ -34,20 +58,46 @@ class Game
 		int _lives = 5;
 		bool _gameOver = false;
 		bool _resetNextUpdate = false;
-		physx::PxRigidActor* _player;
+		physx::PxRigidActor* _player = nullptr;
 		physx::PxTransform _initialPlayerPosition;
-		VisualDebugger::HUD* _hud;
+		VisualDebugger::HUD* _hud = nullptr;
+		Multiball* _multiball = nullptr;
+		Telemetry::Writer* _telemetry = nullptr;
+		EventQueue _events;
+		physx::PxU32 _step = 0;
+		physx::PxU32 _eventCounts[GameEvent::COUNT] = {};
+		ScoringRules _rules;
+		std::vector<ScoringRules::RuleState> _ruleStates;		// Indexed as the rules are.
+		physx::PxU32 _mode = 0;
+		physx::PxU32 _modeEnds = 0;								// Step at which a timed mode returns to the base mode, or 0.
+		physx::PxU32 _games = 0;								// Games which have ended since launch.
+		int _finalScore = 0;									// Score of the last game to end.
 
 		void CheckState();
+		void Process(const GameEvent& e);
+		void Apply(physx::PxU32 index, bool pooled, physx::PxU32 slot);
+		void Award(int points, bool pooled, physx::PxU32 slot);
 
 	public:
 		int score();
 		void score(int modifier);
 		void lives(int modifier);
 		bool gameover();
+		physx::PxU32 games();
+		int finalScore();
 		void player(physx::PxActor* player);
 		void hud(VisualDebugger::HUD* hud);
-		void Reset();
+		void multiball(Multiball* multiball);
+		void telemetry(Telemetry::Writer* telemetry);
+		EventQueue& events();
+		physx::PxU32 eventCount(GameEvent::Type type);
+		physx::PxU32 step();
+		ScoringRules& rules();
+		bool rules(const std::string& path);
+		physx::PxU32 mode();
+		void Reset(bool resetPlayer = true);
+		void Save(State& state);
+		void Load(const State& state);
 		void ResetPlayer();
 		void Update();
 };
@@ -0,0 +1,52 @@
+#include "Input.h"
+#include <cctype>
+#include "Extras/Profiler.h"
+
+using namespace physx;
+
+InputMap::InputMap(PxU32 capacity)
+	: _events(capacity)
+{
+	for (int i = 0; i < 256; i++)
+		_bindings[i] = CONTROL_NONE;
+}
+
+void InputMap::Bind(unsigned char key, InputControl control)
+{
+	_bindings[key] = control;
+	_bindings[(unsigned char)tolower(key)] = control;
+	_bindings[(unsigned char)toupper(key)] = control;
+}
+
+void InputMap::Key(unsigned char key, bool pressed)
+{
+	InputControl control = _bindings[key];
+	if (control == CONTROL_NONE || Held(control) == pressed)
+		return;
+
+	if (pressed)
+		_held |= 1u << control;
+	else _held &= ~(1u << control);
+
+	Event e = { Stopwatch::Microseconds(), control, pressed };
+	_events.Push(e);
+}
+
+bool InputMap::Action(InputControl control, bool pressed, InputAction& action)
+{
+	switch (control)
+	{
+		case CONTROL_FLIPPER_LEFT: action = pressed ? FLIPPER_LEFT_PRESS : FLIPPER_LEFT_RELEASE;
+			return true;
+		case CONTROL_FLIPPER_RIGHT: action = pressed ? FLIPPER_RIGHT_PRESS : FLIPPER_RIGHT_RELEASE;
+			return true;
+		case CONTROL_PLUNGER: action = pressed ? PLUNGER_PULL : PLUNGER_RELEASE;
+			return true;
+		case CONTROL_NUDGE: action = NUDGE;
+			return pressed;
+		case CONTROL_SPAWN_BALL: action = SPAWN_BALL;
+			return pressed;
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,95 @@
+#ifndef input_h
+#define input_h
+
+#include "PxPhysicsAPI.h"
+#include "Extras/EventQueue.h"
+
+// Every player input that affects the simulation. These are applied at the start of a simulation step, or of the substep
+// they happened in, which makes recorded games reproducible when replayed at the same step indices.
+enum InputAction : physx::PxU8
+{
+	FLIPPER_LEFT_PRESS,
+	FLIPPER_LEFT_RELEASE,
+	FLIPPER_RIGHT_PRESS,
+	FLIPPER_RIGHT_RELEASE,
+	PLUNGER_PULL,
+	PLUNGER_RELEASE,
+	NUDGE,
+	SPAWN_BALL,
+	INPUT_ACTION_COUNT
+};
+
+struct InputEvent
+{
+	physx::PxU32 step;		// The simulation step at which the action is applied.
+	InputAction action;
+	physx::PxU8 phase;		// How far through the step the action happened, in 256ths of the step.
+	physx::PxU64 timestamp;	// Wall-clock time of the key event in microseconds, 0 for input not from a key.
+};
+
+// Everything a key can be bound to. Gameplay controls produce an InputAction when pressed and (for those held down)
+// when released, the camera and force controls act on every frame for as long as they are held.
+enum InputControl : physx::PxU8
+{
+	CONTROL_FLIPPER_LEFT,
+	CONTROL_FLIPPER_RIGHT,
+	CONTROL_PLUNGER,
+	CONTROL_NUDGE,
+	CONTROL_SPAWN_BALL,
+	CONTROL_CAMERA_FORWARD,
+	CONTROL_CAMERA_BACKWARD,
+	CONTROL_CAMERA_LEFT,
+	CONTROL_CAMERA_RIGHT,
+	CONTROL_CAMERA_UP,
+	CONTROL_CAMERA_DOWN,
+	CONTROL_FORCE_FORWARD,
+	CONTROL_FORCE_BACKWARD,
+	CONTROL_FORCE_LEFT,
+	CONTROL_FORCE_RIGHT,
+	CONTROL_FORCE_UP,
+	CONTROL_FORCE_DOWN,
+	INPUT_CONTROL_COUNT,
+	CONTROL_NONE = 0xFF
+};
+
+static_assert(INPUT_CONTROL_COUNT <= 32, "InputMap: every control must fit in the held bitset.");
+
+/// <summary>
+/// Maps raw key events onto controls. Each press or release of a bound key becomes a timestamped event, queued without
+/// allocating, and the controls currently held are kept as a bitset so that per-frame controls only visit what is held.
+/// </summary>
+class InputMap
+{
+	public:
+		struct Event
+		{
+			physx::PxU64 timestamp;			// Wall-clock time in microseconds, see Stopwatch::Microseconds.
+			InputControl control;
+			bool pressed;
+		};
+
+	private:
+		InputControl _bindings[256];
+		physx::PxU32 _held = 0;
+		RingBuffer<Event> _events;
+
+	public:
+		InputMap(physx::PxU32 capacity = 256);
+
+		// Bind a key to a control, letters are bound regardless of case.
+		void Bind(unsigned char key, InputControl control);
+
+		// Record a key going down or up. Repeats of a key which is already held are ignored, as are unbound keys.
+		void Key(unsigned char key, bool pressed);
+
+		// Take the oldest event not yet handled, returns false when there are none.
+		bool Pop(Event& e) { return _events.Pop(e); }
+
+		physx::PxU32 Held() const { return _held; }
+		bool Held(InputControl control) const { return (_held >> control) & 1; }
+
+		// The action a control produces when pressed or released, returns false if it produces none.
+		static bool Action(InputControl control, bool pressed, InputAction& action);
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "Latency.h"
+#include <iomanip>
+#include <string>
+
+using namespace physx;
+
+static double Since(PxU64 keyTime, PxU64 now)
+{
+	return (now > keyTime) ? (now - keyTime) / 1000.0 : 0.0;
+}
+
+static void PrintHistogram(std::ostream& out, const char* name, const Histogram& histogram)
+{
+	out << name << ": " << histogram.Samples() << " samples, " << histogram.Average() << "ms mean, " << histogram.Percentile(.5) << "ms p50, "
+		<< histogram.Percentile(.99) << "ms p99, " << histogram.Max() << "ms max" << std::endl;
+
+	// One row per non-empty bucket, scaled so that the fullest bucket is 50 characters wide.
+	unsigned int most = 0;
+	for (unsigned int i = 0; i < histogram.Buckets(); i++)
+		most = PxMax(most, histogram.Bucket(i));
+
+	for (unsigned int i = 0; i < histogram.Buckets(); i++)
+	{
+		if (!histogram.Bucket(i))
+			continue;
+
+		out << std::setw(8) << i * histogram.Width() << "ms" << (i + 1 == histogram.Buckets() ? "+ " : "  ") << std::setw(6) << histogram.Bucket(i) << " "
+			<< std::string(histogram.Bucket(i) * 50 / most, '#') << std::endl;
+	}
+}
+
+InputLatency::InputLatency()
+	: delivered(.5, 100), applied(.5, 100), presented(.5, 100)
+{
+	Clear();
+}
+
+void InputLatency::Delivered(PxU64 keyTime)
+{
+	if (keyTime)
+		delivered.Add(Since(keyTime, Stopwatch::Microseconds()));
+}
+
+void InputLatency::Applied(const InputEvent& e, PxRigidDynamic* flipper)
+{
+	// Input which did not come from a key, e.g. the autopilot's, has no timestamp and is not measured.
+	if (!e.timestamp)
+		return;
+
+	applied.Add(Since(e.timestamp, Stopwatch::Microseconds()));
+
+	int side = (e.action == FLIPPER_LEFT_PRESS || e.action == FLIPPER_LEFT_RELEASE) ? 0 :
+		(e.action == FLIPPER_RIGHT_PRESS || e.action == FLIPPER_RIGHT_RELEASE) ? 1 : -1;
+	if (side < 0 || !flipper)
+		return;
+
+	// A newer input for the same flipper replaces one which has not been seen yet, as it is what the player now expects.
+	_pending[side].keyTime = e.timestamp;
+	_pending[side].body = flipper;
+	_pending[side].rotation = flipper->getGlobalPose().q;
+}
+
+void InputLatency::Presented()
+{
+	PxU64 now = Stopwatch::Microseconds();
+
+	for (int i = 0; i < 2; i++)
+	{
+		Pending& p = _pending[i];
+		if (!p.body)
+			continue;
+
+		// Anything more than about a tenth of a degree counts as visibly moving, the imaginary part of the rotation since
+		// the input was applied has a length of sin(angle / 2), which unlike the real part stays precise for small angles.
+		PxQuat moved = p.body->getGlobalPose().q * p.rotation.getConjugate();
+		if (moved.getImaginaryPart().magnitude() > 1e-3f)
+		{
+			presented.Add(Since(p.keyTime, now));
+			p.body = nullptr;
+		}
+	}
+}
+
+void InputLatency::Clear()
+{
+	for (int i = 0; i < 2; i++)
+		_pending[i].body = nullptr;
+}
+
+void InputLatency::Print(std::ostream& out) const
+{
+	out << std::fixed << std::setprecision(2);
+	PrintHistogram(out, "Key to delivered", delivered);
+	PrintHistogram(out, "Key to applied", applied);
+	PrintHistogram(out, "Key to presented", presented);
+}
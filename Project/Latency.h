@@ -0,0 +1,47 @@
+#ifndef latency_h
+#define latency_h
+
+#include <ostream>
+#include "Input.h"
+#include "Extras/Profiler.h"
+
+/// <summary>
+/// Measures how long flipper input takes to reach the player. Each key event is followed through three stages, each
+/// timed from the key event itself: delivery to the scene, the simulate call which first runs with the new drive, and
+/// the first presented frame which shows the wedge moving.
+/// </summary>
+class InputLatency
+{
+	// A flipper input which has been applied and is waiting for the wedge to be seen moving.
+	struct Pending
+	{
+		physx::PxU64 keyTime;
+		physx::PxRigidDynamic* body;
+		physx::PxQuat rotation;				// Orientation of the wedge when the input was applied.
+	};
+
+	private:
+		Pending _pending[2];				// The latest input for each flipper (left, right), with a null body when idle.
+
+	public:
+		Histogram delivered;				// Key event to the input being queued on the scene.
+		Histogram applied;					// Key event to the start of the simulate call using the new drive.
+		Histogram presented;				// Key event to the swap of the first frame with the wedge moved.
+
+		InputLatency();
+
+		void Delivered(physx::PxU64 keyTime);
+
+		// Called by the scene as it applies an input, just before simulating. Only flipper input is followed further.
+		void Applied(const InputEvent& e, physx::PxRigidDynamic* flipper);
+
+		// Called once a frame has been swapped to the display.
+		void Presented();
+
+		// Forget the flippers being followed, needed before they are released, e.g. when the scene is reset.
+		void Clear();
+
+		void Print(std::ostream& out) const;
+};
+
+#endif
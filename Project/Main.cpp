@@ -1,13 +1,140 @@
 #include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
 #include "VisualDebugger.h"
+#include "Benchmark.h"
+#include "Replay.h"
+#include "Autopilot.h"
+#include "Game.h"
+#include "Tests.h"
 
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
+	// Scoring rules are read before any scene is created, as its triggers and hitpoints are tagged with their rule ids. The
+	// built-in rules, which match the file, are kept if it cannot be read.
+	Game::Instance().rules("../Assets/rules.txt");
+
+	// "-benchmark <name> [args...]" runs one of the benchmarks in place of the interactive demo.
+	if (argc > 1 && string(argv[1]) == "-benchmark")
+	{
+		vector<string> args(argv + 2, argv + argc);
+		if (!Benchmark::Run(args))
+		{
+			cerr << "Unknown benchmark, usage:" << endl;
+			cerr << "  -benchmark multiball [max_balls] [steps] [-norender]" << endl;
+			cerr << "  -benchmark broadphase [dense_balls] [steps]" << endl;
+			cerr << "  -benchmark queries [raycasts] [steps]" << endl;
+			cerr << "  -benchmark telemetry [balls] [steps]" << endl;
+			cerr << "  -benchmark rollback [balls] [resimulated_steps]" << endl;
+			cerr << "  -benchmark substeps [steps]" << endl;
+			cerr << "  -benchmark idle [seconds]" << endl;
+			cerr << "  -benchmark contacts [balls] [steps]" << endl;
+			cerr << "  -benchmark ccd [balls] [launch_speed] [steps]" << endl;
+			cerr << "  -benchmark baked [balls] [steps]" << endl;
+			cerr << "  -benchmark heightfield [resolution] [balls] [steps] [-norender]" << endl;
+			cerr << "  -benchmark mathv [count] [rounds]" << endl;
+			cerr << "  -benchmark suite [scenario...] [-steps n] [-balls n] [-norender] [-json file]" << endl;
+			cerr << "      scenarios: idle autoplay multiball walls resets debugrender hud (default all)" << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// "-test" checks parts of the engine which can be tested without a scene, returning the number of failures.
+	if (argc > 1 && string(argv[1]) == "-test")
+		return (int)Tests::Run();
+
+	// "-scan <file> [-slot n] [-csv]" summarises a telemetry file.
+	if (argc > 2 && string(argv[1]) == "-scan")
+	{
+		int slot = -1;
+		bool csv = false;
+		for (int i = 3; i < argc; i++)
+		{
+			if (string(argv[i]) == "-slot" && i + 1 < argc)
+				slot = atoi(argv[++i]);
+			else if (string(argv[i]) == "-csv")
+				csv = true;
+		}
+		return Telemetry::Scan(argv[2], slot, csv) ? 0 : 1;
+	}
+
+	// "-replay <file> [file...]" verifies recorded games headlessly.
+	if (argc > 2 && string(argv[1]) == "-replay")
+	{
+		vector<string> paths(argv + 2, argv + argc);
+		return Replay::Run(paths) ? 1 : 0;
+	}
+
+	// "-soak <games> [max_steps] [-balls n]" lets the autopilot play headlessly and reports games per hour.
+	if (argc > 2 && string(argv[1]) == "-soak")
+	{
+		physx::PxU32 steps = 0xFFFFFFFF, balls = 8;
+		for (int i = 3; i < argc; i++)
+		{
+			if (string(argv[i]) == "-balls" && i + 1 < argc)
+				balls = (physx::PxU32)atoi(argv[++i]);
+			else steps = (physx::PxU32)atoi(argv[i]);
+		}
+		Soak::Run((physx::PxU32)atoi(argv[2]), steps, balls);
+		return 0;
+	}
+
 	try 
 	{
 		VisualDebugger::Init("Liam Wilson (13458211) - Physics Demo - 30/03/2017", 800, 800); 
+
+		// "-record <file>" records the game's input so that it can be replayed later, "-telemetry <file>" streams the
+		// state of every ball after each step and "-remote <steps>" delays all input by that many steps and hides the
+		// latency by rolling back. "-pvd <debug|profile|all>" streams to the PhysX Visual Debugger, connecting in the
+		// background and reconnecting whenever it is restarted. "-autopilot" lets the autopilot play, F11 toggles it.
+		// "-latency" measures the time from each flipper key press to the screen and "-lowlatency" steps before drawing
+		// and late-latches the flippers' poses.
+		int remote = -1;
+		for (int i = 1; i < argc; i++)
+		{
+			if (string(argv[i]) == "-autopilot")
+			{
+				VisualDebugger::AutoPilot(true);
+				continue;
+			}
+			if (string(argv[i]) == "-latency")
+			{
+				VisualDebugger::MeasureLatency();
+				continue;
+			}
+			if (string(argv[i]) == "-lowlatency")
+			{
+				VisualDebugger::LowLatency(true);
+				continue;
+			}
+			if (i + 1 >= argc)
+				break;
+
+			if (string(argv[i]) == "-record")
+				VisualDebugger::Record(argv[++i]);
+			else if (string(argv[i]) == "-telemetry")
+				VisualDebugger::StreamTelemetry(argv[++i]);
+			else if (string(argv[i]) == "-remote")
+				remote = atoi(argv[++i]);
+			else if (string(argv[i]) == "-pvd")
+			{
+				PhysicsEngine::PvdConfig::Mode mode;
+				if (!PhysicsEngine::PvdConfig::Parse(argv[++i], mode))
+				{
+					cerr << "Unknown -pvd mode \"" << argv[i] << "\", expected none, debug, profile or all." << endl;
+					return 1;
+				}
+				PhysicsEngine::PvdConnect(PhysicsEngine::PvdConfig(mode));
+			}
+		}
+
+		// Remote play turns recording off, so it is only started once every argument has been seen, whatever their order.
+		if (remote >= 0)
+			VisualDebugger::RemotePlay((physx::PxU32)remote);
 	}
 	catch (Exception exc) 
 	{ 
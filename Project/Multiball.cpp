@@ -0,0 +1,190 @@
+#include "Multiball.h"
+#include "Game.h"
+
+using namespace physx;
+
+Multiball::Multiball(PhysicsEngine::Scene* scene, PxU32 capacity, const PxTransform& spawn, PxReal radius, PxReal density, int livesPerBall)
+	: _scene(scene), _spawn(spawn), _livesPerBall(livesPerBall)
+{
+	// Preallocate every pinball up front so that spawning during play never creates actors or shapes. The pool is filled
+	// in reverse so that slot 0 is the first to be handed out.
+	_balls.resize(capacity);
+	_free.reserve(capacity);
+	_lost.reserve(capacity);
+
+	for (PxU32 i = 0; i < capacity; i++)
+	{
+		Ball& b = _balls[i];
+		b.actor = new PhysicsEngine::Pinball(spawn, radius, density);
+		b.lives = 0;
+		b.score = 0;
+		b.active = false;
+
+		// Tag the shape with its slot so that simulation callbacks can attribute events to this ball.
+		PxShape* shape = b.actor->GetShape();
+		PxFilterData data = shape->getSimulationFilterData();
+		data.word2 = i + 1;
+		shape->setSimulationFilterData(data);
+
+		_free.push_back(capacity - 1 - i);
+	}
+}
+
+Multiball::~Multiball()
+{
+	// Remove any balls still in play before releasing the pool, every pooled body is then outside of the scene.
+	RecycleAll();
+
+	for (PxU32 i = 0; i < _balls.size(); i++)
+	{
+		PxActor* actor = _balls[i].actor->Get();
+		delete _balls[i].actor;
+		actor->release();
+	}
+}
+
+int Multiball::Spawn()
+{
+	return Spawn(_spawn);
+}
+
+int Multiball::Spawn(const PxTransform& pose)
+{
+	// Take the next free slot from the pool, returning -1 if every ball is already in play.
+	if (_free.empty())
+		return -1;
+
+	PxU32 slot = _free.back();
+	_free.pop_back();
+
+	_balls[slot].lives = _livesPerBall;
+	_balls[slot].score = 0;
+	Activate(slot, pose);
+
+	return (int)slot;
+}
+
+void Multiball::Recycle(PxU32 slot)
+{
+	// Return an active ball to the pool, this must not be called while the scene is simulating.
+	if (slot >= _balls.size() || !_balls[slot].active)
+		return;
+
+	Deactivate(slot);
+	_free.push_back(slot);
+}
+
+void Multiball::RecycleAll()
+{
+	for (PxU32 i = 0; i < _balls.size(); i++)
+		Recycle(i);
+
+	_lost.clear();
+}
+
+void Multiball::Lost(PxU32 slot)
+{
+	// Called from within the simulation callbacks, the ball is only queued here and handled in Update once it is safe
+	// to modify the scene.
+	if (slot < _balls.size() && _balls[slot].active)
+		_lost.push_back(slot);
+}
+
+void Multiball::Score(PxU32 slot, int points)
+{
+	// Attribute the points to the ball which earned them and add them to the overall game score.
+	if (slot < _balls.size())
+		_balls[slot].score += points;
+
+	Game::Instance().score(points);
+}
+
+void Multiball::Update()
+{
+	// Process every ball which was lost during the last step, respawning it if it has lives remaining and otherwise
+	// returning it to the pool.
+	for (PxU32 i = 0; i < _lost.size(); i++)
+	{
+		PxU32 slot = _lost[i];
+		Ball& b = _balls[slot];
+
+		if (!b.active)
+			continue;
+
+		if (--b.lives > 0)
+		{
+			PxRigidDynamic* body = b.actor->Get()->isRigidDynamic();
+			body->setGlobalPose(_spawn);
+			body->setLinearVelocity(PxVec3(0.f));
+			body->setAngularVelocity(PxVec3(0.f));
+		}
+		else Recycle(slot);
+	}
+
+	_lost.clear();
+}
+
+void Multiball::Save(State& state) const
+{
+	// Called between steps, when no balls are waiting to be processed as lost.
+	state.balls = _balls;
+	state.free = _free;
+}
+
+void Multiball::Load(const State& state)
+{
+	// Add or remove any balls whose membership has changed since the state was saved, their poses and velocities are
+	// then restored along with the rest of the scene.
+	for (PxU32 i = 0; i < _balls.size() && i < state.balls.size(); i++)
+	{
+		if (state.balls[i].active && !_balls[i].active)
+			_scene->Add(_balls[i].actor);
+		else if (!state.balls[i].active && _balls[i].active)
+			_scene->Remove(_balls[i].actor);
+	}
+
+	_balls = state.balls;
+	_free = state.free;
+	_lost.clear();
+	_active = (PxU32)(_balls.size() - _free.size());
+}
+
+void Multiball::Impulse(const PxVec3& impulse)
+{
+	// Apply the same impulse to every ball currently in play.
+	for (PxU32 i = 0; i < _balls.size(); i++)
+		if (_balls[i].active)
+			_balls[i].actor->Get()->isRigidDynamic()->addForce(impulse, PxForceMode::eIMPULSE);
+}
+
+void Multiball::Material(PxMaterial* material)
+{
+	for (PxU32 i = 0; i < _balls.size(); i++)
+		_balls[i].actor->Material(material, 0);
+}
+
+void Multiball::Color(const PxVec3& color)
+{
+	for (PxU32 i = 0; i < _balls.size(); i++)
+		_balls[i].actor->Color(color);
+}
+
+void Multiball::Activate(PxU32 slot, const PxTransform& pose)
+{
+	// Reset the body state while it is outside of the scene and then add it, this is cheaper than adjusting it in place.
+	PxRigidDynamic* body = _balls[slot].actor->Get()->isRigidDynamic();
+	body->setGlobalPose(pose);
+	body->setLinearVelocity(PxVec3(0.f));
+	body->setAngularVelocity(PxVec3(0.f));
+
+	_scene->Add(_balls[slot].actor);
+	_balls[slot].active = true;
+	_active++;
+}
+
+void Multiball::Deactivate(PxU32 slot)
+{
+	_scene->Remove(_balls[slot].actor);
+	_balls[slot].active = false;
+	_active--;
+}
\ No newline at end of file
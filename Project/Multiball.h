@@ -0,0 +1,74 @@
+#ifndef multiball_h
+#define multiball_h
+
+#include <vector>
+#include "Actors/Actors.h"
+
+class Multiball
+{
+	// Per-ball bookkeeping, each ball in the pool keeps its own lives and the score it has earned.
+	struct Ball
+	{
+		PhysicsEngine::Pinball* actor;
+		int lives;
+		int score;
+		bool active;
+	};
+
+	public:
+		// Which balls are in play and their bookkeeping, the balls' bodies are saved with the scene.
+		struct State
+		{
+			std::vector<Ball> balls;
+			std::vector<physx::PxU32> free;
+		};
+
+	private:
+		PhysicsEngine::Scene* _scene;
+		physx::PxTransform _spawn;
+		int _livesPerBall;
+		std::vector<Ball> _balls;
+		std::vector<physx::PxU32> _free;			// Stack of pool slots which are not currently in the scene.
+		std::vector<physx::PxU32> _lost;			// Slots which hit a kill zone during the last simulation step.
+		physx::PxU32 _active = 0;
+
+		void Activate(physx::PxU32 slot, const physx::PxTransform& pose);
+		void Deactivate(physx::PxU32 slot);
+
+	public:
+		Multiball(PhysicsEngine::Scene* scene, physx::PxU32 capacity, const physx::PxTransform& spawn, physx::PxReal radius = .1f,
+			physx::PxReal density = 1.f, int livesPerBall = 1);
+		~Multiball();
+
+		int Spawn();
+		int Spawn(const physx::PxTransform& pose);
+		void Recycle(physx::PxU32 slot);
+		void RecycleAll();
+
+		void Impulse(const physx::PxVec3& impulse);
+
+		void Lost(physx::PxU32 slot);
+		void Score(physx::PxU32 slot, int points);
+		void Update();
+
+		void Save(State& state) const;
+		void Load(const State& state);
+
+		void Material(physx::PxMaterial* material);
+		void Color(const physx::PxVec3& color);
+
+		void LivesPerBall(int value) { _livesPerBall = value; }
+
+		physx::PxU32 Active() const { return _active; }
+		bool Active(physx::PxU32 slot) const { return _balls[slot].active; }
+		PhysicsEngine::Pinball* Get(physx::PxU32 slot) const { return _balls[slot].actor; }
+		physx::PxU32 Capacity() const { return (physx::PxU32)_balls.size(); }
+		int Score(physx::PxU32 slot) const { return _balls[slot].score; }
+		int Lives(physx::PxU32 slot) const { return _balls[slot].lives; }
+
+		// Pinball shapes owned by a pool store (slot + 1) in filter word2, the player ball leaves it at 0.
+		static physx::PxU32 SlotFromFilter(const physx::PxFilterData& data) { return data.word2 - 1; }
+		static bool IsPooled(const physx::PxFilterData& data) { return data.word2 != 0; }
+};
+
+#endif
\ No newline at end of file
@@ -7,6 +7,11 @@
 #include "Extras/MaterialLibrary.h"
 #include "Extras/ColorLibrary.h"
 #include "Extras/Triggers.h"
+#include "Extras/FilterTable.h"
+#include "Multiball.h"
+#include "Replay.h"
+#include "Telemetry.h"
+#include "Latency.h"
 
 namespace PhysicsEngine
 {
@@ -14,31 +19,28 @@ namespace PhysicsEngine
 
 	static const PxReal PxQuartPi = PxHalfPi / 2.f;	// Quarter of PI
 
-	static PxFilterFlags CustomFilterShader( PxFilterObjectAttributes attributes0,	PxFilterData filterData0,
-		PxFilterObjectAttributes attributes1,	PxFilterData filterData1,
-		PxPairFlags& pairFlags,	const void* constantBlock,	PxU32 constantBlockSize)
+	// Collision and notification rules for every pair of filter groups. Pairs which are not listed collide with CCD and
+	// nothing is reported, this covers all of the scenery (group 0) and the flippers and plunger. The hitpoints only ever
+	// move slowly, so CCD is left off for their pairs with anything other than a ball. Triggers only report
+	// when a rule asks for it, so balls are the only shapes that trigger zones see.
+	struct TableRules
 	{
-		if(PxFilterObjectIsTrigger(attributes0) || PxFilterObjectIsTrigger(attributes1))
-		{
-			pairFlags = PxPairFlag::eTRIGGER_DEFAULT;
-			return PxFilterFlags();
-		}
-
-		// Enable CCD and CONTACT reporting on the scene level.
-		pairFlags = PxPairFlag::eSOLVE_CONTACT;
-		pairFlags |= PxPairFlag::eDETECT_DISCRETE_CONTACT;
-		pairFlags |= PxPairFlag::eDETECT_CCD_CONTACT;
-		
-		if((filterData0.word0 & filterData1.word1) && (filterData1.word0 & filterData0.word1))
-		{
-			pairFlags |= PxPairFlag::eNOTIFY_TOUCH_FOUND;
-			pairFlags |= PxPairFlag::eNOTIFY_TOUCH_LOST;
-			pairFlags |= PxPairFlag::eNOTIFY_CONTACT_POINTS;
-		}
-
-		return PxFilterFlags();
+		static constexpr FilterRule rules[] = {
+			{ FilterGroup::PLAYER, FilterGroup::HITPOINT, FilterFlag::SOLVE | FilterFlag::CCD | FilterFlag::NOTIFY },
+			{ FilterGroup::PLAYER, FilterGroup::SCOREZONE, FilterFlag::TRIGGER },
+			{ FilterGroup::PLAYER, FilterGroup::KILLZONE, FilterFlag::TRIGGER },
+			{ FilterGroup::HITPOINT, 0, FilterFlag::SOLVE },
+			{ FilterGroup::HITPOINT, FilterGroup::HITPOINT, FilterFlag::SOLVE }
+		};
+		static constexpr PxU32 count = sizeof(rules) / sizeof(FilterRule);
+		static constexpr PxU8 fallback = FilterFlag::SOLVE | FilterFlag::CCD;
 	};
 
+	// Every FilterGroup fits in the lowest 4 bits of word0, adding a group beyond that needs this increasing.
+	typedef FilterTable<TableRules, 4> TableFilter;
+
+	static const PxSimulationFilterShader CustomFilterShader = TableFilter::Shader;
+
 	class MyScene : public Scene
 	{
 		private:
@@ -50,14 +52,92 @@ namespace PhysicsEngine
 			Pinball *ball;							// Reference kept for moving the player back to spawn.
 			std::vector<TriggerZone*> triggers;		// Reference to the triggers within the scene for visualisation toggling.
 			CustomSimulationCallback *my_callback;	// Pointer to a CustomSimulationCallback.
+			PxU32 multiballCapacity;				// Number of pinballs preallocated for multiball play.
+			ContactReporting reporting;				// Contact data requested for scoring pairs, see Reporting.
+			std::vector<InputEvent> pendingInput;	// Actions waiting to be applied during the next step.
+			std::vector<InputEvent> heldInput;		// Releases held back to the next step, see CustomSubstep.
+			bool plungerPulled;						// Whether the plunger is currently held down.
+			bool bakeStatics = false;				// Whether the walls and platform are merged into one StaticMesh, see BakeStatics.
+			std::vector<StaticActor*> staticParts;	// Walls and the platform waiting to be baked while the actors are initialised.
+			StaticMesh *baked = nullptr;			// The merged walls and platform when baking, otherwise null.
+		
+			// Where a wall or hitpoint sits on the platform, see AddWalls and AddHitpoints.
+			struct WallLayout
+			{
+				PxVec2 placement;
+				PxReal rotation;
+				float scale;
+				int divisions;
+				float bendFactor;
+			};
+
+			struct HitpointLayout
+			{
+				PxVec2 placement;
+				const char* rule;
+			};
 		
 		public:
+			// The complete state of the table and the game between two steps, see SaveSnapshot.
+			struct Snapshot
+			{
+				SceneState scene;
+				Game::State game;
+				Multiball::State multiball;
+				bool plungerPulled;
+				std::vector<InputEvent> heldInput;	// Releases held back from the step before.
+			};
+
 			// Public Actor variables which require access in other classes after they have been added to the scene.
 			Plunger *plunger;
 			Flipper *flipperL;
 			Flipper *flipperR;
+			Multiball *multiball;
+			Recording *recording = nullptr;			// When set, every applied input is recorded with its step index.
+			Telemetry::Writer *telemetry = nullptr;	// When set, the state of every ball in play is streamed after each step.
+			InputLatency *latency = nullptr;		// When set, the latency of every timestamped input is measured as it is applied.
+
+			MyScene(PxU32 multiball_capacity = 8) : Scene(CustomFilterShader), multiballCapacity(multiball_capacity)
+			{
+				Reporting(ContactReporting());
+			}
 
-			MyScene() : Scene(CustomFilterShader) {};
+			void Reporting(const ContactReporting& value)
+			{
+				// Takes effect on the next Init or Reset, as the filter shader's constant block is copied into the scene. In
+				// minimal mode the game only scores the first touch, so nothing else is asked for. With a threshold, PhysX
+				// compares the contact force against the actors' report thresholds and only reports touches above it.
+				reporting = value;
+
+				FilterShaderBlock block;
+				if (reporting.mode == ContactReporting::MINIMAL)
+					block.notifyFlags = (reporting.forceThreshold > 0.f) ? PxPairFlag::eNOTIFY_THRESHOLD_FORCE_FOUND : PxPairFlag::eNOTIFY_TOUCH_FOUND;
+				else block.notifyFlags = PxPairFlag::eNOTIFY_TOUCH_FOUND | PxPairFlag::eNOTIFY_TOUCH_LOST | PxPairFlag::eNOTIFY_CONTACT_POINTS;
+
+				FilterShaderData(&block, sizeof(FilterShaderBlock));
+			}
+
+			const ContactReporting& Reporting()
+			{
+				return reporting;
+			}
+
+			void BakeStatics(bool value)
+			{
+				// Takes effect on the next Init or Reset. The platform is still created for placing the other actors, but only
+				// the baked mesh is added to the scene.
+				bakeStatics = value;
+			}
+
+			StaticMesh* Baked()
+			{
+				return baked;
+			}
+
+			PxU32 MultiballCapacity()
+			{
+				return multiballCapacity;
+			}
 
 			void SetVisualisation()
 			{
@@ -78,22 +158,208 @@ namespace PhysicsEngine
 
 				GetMaterial()->setDynamicFriction(.2f);
 
-				my_callback = new CustomSimulationCallback();
-				px_scene->setSimulationEventCallback(my_callback);
-
-				// Enable CCD on the scene.
-				px_scene->setFlag(PxSceneFlag::eENABLE_CCD, true);
-
 				// Call the InitActors function to build all of the necessary actors for the scene.
 				InitActors();
 
+				// Every actor is expected to stay on or just above the table, so the platform bounds are used as the world
+				// bounds. With multi-box pruning this also derives the broadphase regions.
+				WorldBounds((baked ? (Actor*)baked : (Actor*)platform)->Get()->getWorldBounds());
+
+				// Balls, the plunger and the flippers are the only bodies fast enough to need CCD, the scene's CCD policy
+				// decides when each of them uses it.
+				CCDBody(ball->Get()->isRigidDynamic());
+				for (PxU32 i = 0; i < multiball->Capacity(); i++)
+					CCDBody(multiball->Get(i)->Get()->isRigidDynamic());
+				CCDBody(plunger->Body());
+				CCDBody(flipperL->Body());
+				CCDBody(flipperR->Body());
+
+				// Contact force thresholds are set per actor, and only balls take part in scoring contacts.
+				if (reporting.mode == ContactReporting::MINIMAL && reporting.forceThreshold > 0.f)
+				{
+					ball->Get()->isRigidDynamic()->setContactReportThreshold(reporting.forceThreshold);
+					for (PxU32 i = 0; i < multiball->Capacity(); i++)
+						multiball->Get(i)->Get()->isRigidDynamic()->setContactReportThreshold(reporting.forceThreshold);
+				}
+
+				// The callback only queues events, which the game manager drains and attributes to the player or the
+				// multiball pool after each step.
+				my_callback = new CustomSimulationCallback(reporting.debounceSteps);
+				px_scene->setSimulationEventCallback(my_callback);
+				Game::Instance().multiball(multiball);
+
 				// Set the player reference in the game manager class.
 				Game::Instance().player(ball->Get());
+
+				// Discard any input from before the scene was (re)initialised.
+				pendingInput.clear();
+				heldInput.clear();
+				plungerPulled = false;
+			}
+
+			virtual void CustomRelease()
+			{
+				// The multiball pool is rebuilt by every CustomInit, so the old pool and its bodies are freed before a reset.
+				delete multiball;
+				multiball = nullptr;
+
+				// A baked platform is kept outside of the scene, so it is not released along with the scene's actors.
+				if (baked)
+				{
+					PxActor* actor = platform->Get();
+					delete platform;
+					actor->release();
+					platform = nullptr;
+				}
+			}
+
+			virtual PxU32 Substeps(PxReal dt)
+			{
+				// Substep only while something is moving fast enough to tunnel or overshoot in a full step: a swinging
+				// flipper, a plunger which has just been released, or a fast ball. A calm table takes a single step.
+				const PxReal flipperSpeed = 1.f;		// rad/s, the flippers are near zero while resting on a limit.
+				const PxReal plungerSpeed = .5f;		// m/s
+
+				if (flipperL->AngularSpeed() > flipperSpeed || flipperR->AngularSpeed() > flipperSpeed || plunger->Speed() > plungerSpeed)
+					return Config().max_substeps;
+
+				PxReal ballSpeed = Config().substep_speed;
+				if (ball->Get()->isRigidDynamic()->getLinearVelocity().magnitude() > ballSpeed)
+					return Config().max_substeps;
+
+				for (PxU32 i = 0; i < multiball->Capacity(); i++)
+					if (multiball->Active(i) && multiball->Get(i)->Get()->isRigidDynamic()->getLinearVelocity().magnitude() > ballSpeed)
+						return Config().max_substeps;
+
+				return 1;
 			}
 
-			virtual void CustomUpdate() 
+			virtual void CustomSubstep(PxU32 substep, PxU32 substeps)
 			{
-				
+				// Apply the input which happened during this substep's share of the step. The substep count only depends on
+				// the state of the table, so recording the step index and phase is enough to replay a game exactly.
+				PxU32 pressed = 0;
+				for (unsigned int i = 0; i < pendingInput.size(); i++)
+				{
+					if (((PxU32)pendingInput[i].phase * substeps) >> 8 != substep)
+						continue;
+
+					// A press and its release within one substep would cancel out before the simulation saw either, which is
+					// always the case for a quick tap on a calm table taking a single step. The release is held back to the
+					// start of the next step and recorded there, so replays see it where it was applied.
+					InputAction press = PressFor(pendingInput[i].action);
+					if (press != INPUT_ACTION_COUNT && (pressed & (1u << press)))
+					{
+						InputEvent held = pendingInput[i];
+						held.step++;
+						held.phase = 0;
+						heldInput.push_back(held);
+						continue;
+					}
+					pressed |= 1u << pendingInput[i].action;
+
+					if (recording)
+						recording->Record(pendingInput[i].step, pendingInput[i].action, pendingInput[i].phase);
+					Apply(pendingInput[i].action);
+
+					if (latency)
+						latency->Applied(pendingInput[i], FlipperBody(pendingInput[i].action));
+				}
+
+				if (substep + 1 == substeps)
+				{
+					pendingInput.swap(heldInput);
+					heldInput.clear();
+				}
+
+				// The plunger is pulled continuously for as long as it is held. Forces only last for one simulate call, so
+				// this is applied on every substep to keep the total impulse independent of the substep count.
+				if (plungerPulled)
+					plunger->Pull();
+			}
+
+			void SaveSnapshot(Snapshot& snapshot)
+			{
+				// Capture everything needed to resimulate from the current step. Only valid between steps, when the only
+				// pending input is releases held back from the last step and the game has drained its event queue.
+				Save(snapshot.scene);
+				Game::Instance().Save(snapshot.game);
+				multiball->Save(snapshot.multiball);
+				snapshot.plungerPulled = plungerPulled;
+				snapshot.heldInput = pendingInput;
+			}
+
+			void LoadSnapshot(const Snapshot& snapshot)
+			{
+				// Pooled balls must be back in the scene before the scene state restores their bodies.
+				multiball->Load(snapshot.multiball);
+				Load(snapshot.scene);
+				Game::Instance().Load(snapshot.game);
+				plungerPulled = snapshot.plungerPulled;
+				pendingInput = snapshot.heldInput;
+			}
+
+			void Queue(InputAction action, PxU8 phase = 0, PxU64 timestamp = 0)
+			{
+				// Queue an input action to be applied during the next simulation step, phase is how far through the step
+				// it happened in 256ths of the step. Actions queued with the same phase are applied in the order queued.
+				InputEvent e = { StepCount(), action, phase, timestamp };
+				pendingInput.push_back(e);
+			}
+
+			void Apply(InputAction action)
+			{
+				switch (action)
+				{
+					case FLIPPER_LEFT_PRESS:
+					case FLIPPER_LEFT_RELEASE: flipperL->InvertDrive();
+						break;
+					case FLIPPER_RIGHT_PRESS:
+					case FLIPPER_RIGHT_RELEASE: flipperR->InvertDrive();
+						break;
+					case PLUNGER_PULL: plungerPulled = true;
+						break;
+					case PLUNGER_RELEASE:
+						plungerPulled = false;
+						plunger->Release();
+						break;
+					case NUDGE: Nudge(.05f);
+						break;
+					case SPAWN_BALL: multiball->Spawn();
+						break;
+					default:
+						break;
+				}
+			}
+
+			static InputAction PressFor(InputAction release)
+			{
+				// The press a release undoes, or INPUT_ACTION_COUNT for actions which are not a release.
+				switch (release)
+				{
+					case FLIPPER_LEFT_RELEASE: return FLIPPER_LEFT_PRESS;
+					case FLIPPER_RIGHT_RELEASE: return FLIPPER_RIGHT_PRESS;
+					case PLUNGER_RELEASE: return PLUNGER_PULL;
+					default: return INPUT_ACTION_COUNT;
+				}
+			}
+
+			PxRigidDynamic* FlipperBody(InputAction action)
+			{
+				// The wedge an action drives, or null for actions which are not for a flipper.
+				if (action == FLIPPER_LEFT_PRESS || action == FLIPPER_LEFT_RELEASE)
+					return flipperL->Body();
+				if (action == FLIPPER_RIGHT_PRESS || action == FLIPPER_RIGHT_RELEASE)
+					return flipperR->Body();
+				return nullptr;
+			}
+
+			void Nudge(PxReal strength)
+			{
+				// Nudging the table is approximated by pushing every ball in play a short way up the table.
+				PxVec3 impulse = Mathv::Multiply(platform->RelativeTransform(PxVec2(0.f)).q, PxVec3(0.f, 1.f, 0.f)) * strength;
+				ball->Get()->isRigidDynamic()->addForce(impulse, PxForceMode::eIMPULSE);
+				multiball->Impulse(impulse);
 			}
 
 			virtual void PostUpdate()
@@ -102,12 +368,30 @@ namespace PhysicsEngine
 				// been called. This is essential to avoiding API errors when performing direct and immediate re-positioning
 				// of actors in a scene using setGlobalPose.
 				Game::Instance().Update();
+
+				// Respawn or recycle any multiball pinballs which were lost during this step.
+				multiball->Update();
+
+				if (telemetry)
+					WriteTelemetry();
+			}
+
+			void WriteTelemetry()
+			{
+				// Slot 0 is the player's ball, followed by every pooled ball currently in play. Minimal reporting never
+				// reports a contact being lost, which the telemetry has to know to count contacts.
+				telemetry->LostContacts(reporting.mode == ContactReporting::FULL);
+				telemetry->Write(StepCount(), 0, ball->Get()->isRigidDynamic());
+				for (PxU32 i = 0; i < multiball->Capacity(); i++)
+					if (multiball->Active(i))
+						telemetry->Write(StepCount(), i + 1, multiball->Get(i)->Get()->isRigidDynamic());
 			}
 
 			void InitActors()
 			{
 				// This describes the tilt factor of the table.
 				float table_tilt = -PxPi / 3.f;
+				baked = nullptr;
 
 				// Initialize a basic plane and add it to the scene.
 				plane = new Plane();
@@ -119,20 +403,25 @@ namespace PhysicsEngine
 				// table is coloured with white walls and a 20% gray floor using the colour library Fetch function.
 				platform = new Platform(PxTransform(PxVec3(.0f, 7.f, .0f), Mathv::EulerToQuat(0, 0, table_tilt)), 4, .05f, PxVec3(4.f, 8.f, 5.f));
 				platform->Materials(MaterialLibrary::Instance().New("wood", 0.125f, 0.f, 0.603f));
-				platform->SetColor(LColor::Get().Fetch("white"), LColor::Get().Fetch("gray-20"));
-				Add(platform);
+				platform->SetColor(LColor::Get().Fetch(LColor::WHITE), LColor::Get().Fetch(LColor::GRAY_20));
+				AddStatic(platform);
 
 				// Initialize the pinball object at a relative transform which places it above the intended plunger position.
 				// The material library is utilised here to create a steel texture with a set of real-life parameters. The ball
 				// is coloured a soft blue using the colour library fetch function.
 				ball = new Pinball(platform->RelativeTransform(PxVec2(.9475f, -.4f)), .1f, 1.f);
 				ball->Material(MaterialLibrary::Instance().New("steel", 0.25f, 0.f, 0.597f), 0);
-				ball->Color(LColor::Get().Fetch("soft-blue"));
+				ball->Color(LColor::Get().Fetch(LColor::SOFT_BLUE));
 				Add(ball);
 
+				// Preallocate the multiball pool, spawning at the top of the table so that extra balls drop into play.
+				multiball = new Multiball(this, multiballCapacity, platform->RelativeTransform(PxVec2(0.f, .8f), -.15f), .1f, 1.f);
+				multiball->Material(MaterialLibrary::Instance().Get("steel"));
+				multiball->Color(LColor::Get().Fetch("soft-yellow", 1.f, 1.f, .3f));
+
 				// Initialize the plunger at roughly the bottom right of the platform, colouring it soft red.
 				plunger = new Plunger(platform->RelativeTransform(PxVec2(.9475f, -.9825f)), PxVec3(.1f, .1f, .25f), 1.545f, .05f, 12.f, .5f);
-				plunger->SetColor(LColor::Get().Fetch("soft-red"));
+				plunger->SetColor(LColor::Get().Fetch(LColor::SOFT_RED));
 				plunger->AddToScene(this);
 
 				// Initialize both the flippers in a mirrored fashion towards the lower end of the table. Multiple rotations
@@ -142,43 +431,54 @@ namespace PhysicsEngine
 				flipperR = AddFlipper(Mathv::Multiply(platform->RelativeTransform(PxVec2(.3f, -.75f)), Mathv::EulerToQuat(0, PxHalfPi, -PxHalfPi)), -30.0f);
 
 				// Initialize and add all of the walls/obstacles to the platform at a selection of tried and tested positions.
-				// Left Walls
-				AddWall(PxVec2(-.4f, -.85f), PxHalfPi, .9f);
-				AddWall(PxVec2(-.675f, -.55f), -PxQuartPi, 1.325f);
-				AddWall(PxVec2(-.755f, -0.1525f), -PxQuartPi * 2.75f, 1.25f, 3, .125f);
-				AddWall(PxVec2(-.5f, .725f), PxPi + PxQuartPi, 2.f, 4, .225f);
-				AddWall(PxVec2(-.755f, .2125f), -PxQuartPi*1.25f, 1.25f, 3, .15f);
-
-				// Right Walls
-				AddWall(PxVec2(.4f, -.85f), PxHalfPi, .9f);
-				AddWall(PxVec2(.62f, -.5775f), PxQuartPi, 1.12f);
-				AddWall(PxVec2(.755f, -0.1525f), PxQuartPi * 2.75f, 1.25f, 3, .125f);
-				AddWall(PxVec2(.5f, .725f), PxHalfPi + PxQuartPi, 2.f, 4, .225f);
-				AddWall(PxVec2(.755f, .2125f), PxQuartPi*1.25f, 1.25f, 3, .15f);
-
-				// Central Walls
-				AddWall(PxVec2(.45f, .475f), PxHalfPi, 1.5f, 4, .25f);
+				const WallLayout walls[] = {
+					// Left Walls
+					{ PxVec2(-.4f, -.85f), PxHalfPi, .9f },
+					{ PxVec2(-.675f, -.55f), -PxQuartPi, 1.325f },
+					{ PxVec2(-.755f, -0.1525f), -PxQuartPi * 2.75f, 1.25f, 3, .125f },
+					{ PxVec2(-.5f, .725f), PxPi + PxQuartPi, 2.f, 4, .225f },
+					{ PxVec2(-.755f, .2125f), -PxQuartPi*1.25f, 1.25f, 3, .15f },
+
+					// Right Walls
+					{ PxVec2(.4f, -.85f), PxHalfPi, .9f },
+					{ PxVec2(.62f, -.5775f), PxQuartPi, 1.12f },
+					{ PxVec2(.755f, -0.1525f), PxQuartPi * 2.75f, 1.25f, 3, .125f },
+					{ PxVec2(.5f, .725f), PxHalfPi + PxQuartPi, 2.f, 4, .225f },
+					{ PxVec2(.755f, .2125f), PxQuartPi*1.25f, 1.25f, 3, .15f },
+
+					// Central Walls
+					{ PxVec2(.45f, .475f), PxHalfPi, 1.5f, 4, .25f }
+				};
+				AddWalls(walls, sizeof(walls) / sizeof(walls[0]));
+
+				// Merge the walls and the platform into a single actor now that all of them have been created.
+				if (bakeStatics)
+					BakeStaticParts();
 
 				// Initialize and all all of the hitpoints within the scene, this describes with obstaces which can be
-				// interacted with and which provide score to the player.
-				// Upper
-				AddHitpoint(PxVec2(-.5f, .7f), -PxHalfPi, PxVec2(.2f, .02f));
-				AddHitpoint(PxVec2(-.1f, .2f), -PxHalfPi, PxVec2(.2f, .02f));
-				AddHitpoint(PxVec2(-.3f, .4f), -PxHalfPi, PxVec2(.2f, .02f));
-				AddHitpoint(PxVec2(.1f, .4f), -PxHalfPi, PxVec2(.2f, .02f));
-
-				// Lower
-				AddHitpoint(PxVec2(-.4f, -.3f), -PxHalfPi, PxVec2(.2f, .02f));
-				AddHitpoint(PxVec2(.4f, -.3f), -PxHalfPi, PxVec2(.2f, .02f));
+				// interacted with and which provide score to the player. What each one scores is given by the rule it is tagged
+				// with, see Assets/rules.txt.
+				const HitpointLayout hitpoints[] = {
+					// Upper
+					{ PxVec2(-.5f, .7f), "upper_target" },
+					{ PxVec2(-.1f, .2f), "upper_target" },
+					{ PxVec2(-.3f, .4f), "upper_target" },
+					{ PxVec2(.1f, .4f), "upper_target" },
+
+					// Lower
+					{ PxVec2(-.4f, -.3f), "lower_target" },
+					{ PxVec2(.4f, -.3f), "lower_target" }
+				};
+				AddHitpoints(hitpoints, sizeof(hitpoints) / sizeof(hitpoints[0]), -PxHalfPi, PxVec2(.2f, .02f));
 
 				// Initialize and add all of the trigger areas, including those with negative and positive effects. These can
 				// be visualised using F5 during runtime.
-				AddTrigger(PxVec2(0.f, -1.15f), 0.f, 1.1f, FilterGroup::KILLZONE);
-				AddTrigger(PxVec2(.65f, .135f), .2f, .5f, FilterGroup::SCOREZONE);
-				AddTrigger(PxVec2(.65f, .81f), -.2f, .5f, FilterGroup::SCOREZONE);
+				AddTrigger(PxVec2(0.f, -1.15f), 0.f, 1.1f, FilterGroup::KILLZONE, "drain");
+				AddTrigger(PxVec2(.65f, .135f), .2f, .5f, FilterGroup::SCOREZONE, "lower_lane");
+				AddTrigger(PxVec2(.65f, .81f), -.2f, .5f, FilterGroup::SCOREZONE, "upper_lane");
 			}
 
-			Flipper* AddFlipper(const PxTransform& transform, float initDrive, const char* material = "wood", PxVec3 color = LColor::Get().Fetch("soft-purple"))
+			Flipper* AddFlipper(const PxTransform& transform, float initDrive, const char* material = "wood", PxVec3 color = LColor::Get().Fetch(LColor::SOFT_PURPLE))
 			{
 				// Initialize a flipper object with some default values and return the result.
 				Flipper* f = new Flipper(this, transform, .8f, initDrive, -PxPi / 4.f, PxPi / 4.f);
@@ -188,44 +488,111 @@ namespace PhysicsEngine
 				return f;
 			}
 
-			Hitpoint* AddHitpoint(PxVec2 placement, PxReal rotation, PxVec2 scale, PxVec3 color = LColor::Get().Fetch("soft-orange"))
+			void AddHitpoints(const HitpointLayout* hitpoints, PxU32 count, PxReal rotation, PxVec2 scale, PxVec3 color = LColor::Get().Fetch(LColor::SOFT_ORANGE))
 			{
-				// Initialize a hitpoint object with some default values and return the result. The filter group of
-				// HITPOINT is applied to each object added this way which interacts and reports contact with PLAYER layers.
-				Hitpoint* hp = new Hitpoint(this, Mathv::Multiply(platform->RelativeTransform(placement, -.15f), PxQuat(rotation, PxVec3(0, 1, 0))), scale, .1f);
-				hp->SetMaterial(MaterialLibrary::Instance().New("glass", 0.475f, 0.f, .69f));
-				hp->Get()->SetupFiltering(FilterGroup::HITPOINT, FilterGroup::PLAYER);
-				hp->Get()->Color(color);
+				// Initialize hitpoint objects with some default values, all placed relative to the platform in one batched call.
+				// The filter group of HITPOINT is applied to each object added this way, which TableRules has interact and report
+				// contact with PLAYER, and the named scoring rule decides what a contact is worth.
+				std::vector<PxVec3> offsets(count);
+				std::vector<PxQuat> rotations(count, PxQuat(rotation, PxVec3(0, 1, 0)));
+				std::vector<PxTransform> poses(count);
+				for (PxU32 i = 0; i < count; i++)
+					offsets[i] = PxVec3(hitpoints[i].placement.x, hitpoints[i].placement.y, -.15f);
+				platform->RelativeTransforms(&offsets.front(), &rotations.front(), &poses.front(), count);
+
+				for (PxU32 i = 0; i < count; i++)
+				{
+					Hitpoint* hp = new Hitpoint(this, poses[i], scale, .1f);
+					hp->SetMaterial(MaterialLibrary::Instance().New("glass", 0.475f, 0.f, .69f));
+					hp->Get()->SetupFiltering(FilterGroup::HITPOINT);
+					hp->Get()->SetupRule(Game::Instance().rules().Id(hitpoints[i].rule));
+					hp->Get()->Color(color);
+				}
+			}
 
-				return hp;
+			void AddWalls(const WallLayout* walls, PxU32 count, float height = .25f, float thickness = .05f)
+			{
+				// Initialize curved wall objects with some default values, all placed relative to the platform in one batched
+				// call. This implementation caters to both curved and flat walls by simply changing the bend factor of the wall.
+				std::vector<PxVec3> offsets(count);
+				std::vector<PxQuat> rotations(count);
+				std::vector<PxTransform> poses(count);
+				for (PxU32 i = 0; i < count; i++)
+				{
+					offsets[i] = PxVec3(walls[i].placement.x, walls[i].placement.y, 0.f);
+					rotations[i] = PxQuat(walls[i].rotation, PxVec3(0, 0, 1));
+				}
+				platform->RelativeTransforms(&offsets.front(), &rotations.front(), &poses.front(), count);
+
+				for (PxU32 i = 0; i < count; i++)
+				{
+					CurvedWall* cw = new CurvedWall(poses[i], walls[i].scale, walls[i].divisions, walls[i].bendFactor, height, thickness);
+					cw->SetMaterial(MaterialLibrary::Instance().Get("wood"));
+					AddStatic(cw);
+				}
 			}
 
-			void AddWall(PxVec2 placement, PxReal rotation, float scale = 1.f, int divisions = 0, float bendFactor = 0.f, float height = .25f, float thickness = .05f)
+			void AddStatic(StaticActor* actor)
 			{
-				// Initialize a curved wall object with some default values. This implementation caters to both curved and 
-				// flat walls by simply changing the bend factor of the wall.
-				CurvedWall* cw = new CurvedWall(Mathv::Multiply(platform->RelativeTransform(placement), PxQuat(rotation, PxVec3(0, 0, 1))), scale, divisions, bendFactor, height, thickness);
-				cw->SetMaterial(MaterialLibrary::Instance().Get("wood"));
-				Add(cw);
+				// Static table geometry is either added straight away or held back to be baked.
+				if (bakeStatics)
+					staticParts.push_back(actor);
+				else Add(actor);
 			}
 
-			void AddTrigger(PxVec2 placement, PxReal rotation, PxReal scale, int filterGroup)
+			void BakeStaticParts()
+			{
+				// Replace the collected walls and platform with one mesh per material and colour. The wall actors are no longer
+				// needed and are released, the platform is kept outside of the scene for Platform::RelativeTransform.
+				baked = new StaticMesh(staticParts);
+				Add(baked);
+
+				for (PxU32 i = 0; i < staticParts.size(); i++)
+				{
+					if (staticParts[i] == platform)
+						continue;
+
+					PxActor* actor = staticParts[i]->Get();
+					delete staticParts[i];
+					actor->release();
+				}
+
+				staticParts.clear();
+			}
+
+			void AddTrigger(PxVec2 placement, PxReal rotation, PxReal scale, int filterGroup, const char* rule)
 			{
 				// Initialize a trigger zone, making use of the Mathv library to perform complex operations in a neat fashion.
 				TriggerZone* t = new TriggerZone(Mathv::Multiply(platform->RelativeTransform(placement), PxQuat(rotation, PxVec3(0, 0, 1))), PxVec3(scale), filterGroup);
+				t->SetupRule(Game::Instance().rules().Id(rule));
 
 				// Determine the colour of the trigger based on the filterGroup provided, this is only visible when trigger
 				// visualisation is active (F5).
 				if (filterGroup == FilterGroup::KILLZONE)
-					t->Color(LColor::Get().Fetch("soft-red"));
+					t->Color(LColor::Get().Fetch(LColor::SOFT_RED));
 				else if (filterGroup == FilterGroup::SCOREZONE)
-					t->Color(LColor::Get().Fetch("soft-green"));
+					t->Color(LColor::Get().Fetch(LColor::SOFT_GREEN));
 
 				// Add the trigger zone to the scene and push it back to the list of triggers.
 				Add(t);
 				triggers.push_back(t);
 			}
 
+			Platform* GetPlatform()
+			{
+				return platform;
+			}
+
+			Pinball* GetBall()
+			{
+				return ball;
+			}
+
+			CustomSimulationCallback* Callback()
+			{
+				return my_callback;
+			}
+
 			void ToggleTriggersVisible()
 			{
 				// Toggle the visibility for all trigger zones in the scene.
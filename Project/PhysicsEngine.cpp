@@ -1,5 +1,16 @@
+//winsock has to come before anything which might include windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include "PhysicsEngine.h"
+#include "Extras/Allocations.h"
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+
+#pragma comment(lib, "Ws2_32.lib")
 
 namespace PhysicsEngine
 {
@@ -7,13 +18,23 @@ namespace PhysicsEngine
 	using namespace std;
 
 	PxDefaultErrorCallback gDefaultErrorCallback;
-	PxDefaultAllocator gDefaultAllocatorCallback;
+	CountingAllocator gDefaultAllocatorCallback;
 
 	PxFoundation* foundation = 0;
 	debugger::comm::PvdConnection* vd_connection = 0;
 	PxPhysics* physics = 0;
 	PxCooking* cooking = 0;
 
+	//background PVD probe, the worker only checks whether anything is listening and never touches vd_connection, which
+	//is created and released on the main thread between steps by PvdUpdate
+	std::thread pvd_thread;
+	std::mutex pvd_mutex;
+	std::condition_variable pvd_wake;
+	bool pvd_stop = false;
+	std::atomic<bool> pvd_listening(false);
+	std::atomic<bool> pvd_connected(false);
+	PvdConfig pvd_config;
+
 	void PxInit()
 	{
 		if (!foundation)
@@ -37,17 +58,140 @@ namespace PhysicsEngine
 		if(!cooking)
 			throw new Exception("PhysicsEngine::PxInit, Could not initialise the cooking component.");
 
-		if (!vd_connection)
-			vd_connection = PxVisualDebuggerExt::createConnection(physics->getPvdConnectionManager(), 
-			"localhost", 5425, 100, PxVisualDebuggerExt::getAllConnectionFlags());
-
 		CreateMaterial();
 	}
 
-	void PxRelease()
+	bool PvdConfig::Parse(const string& name, Mode& mode)
+	{
+		if (name == "none")
+			mode = NONE;
+		else if (name == "debug")
+			mode = DEBUG;
+		else if (name == "profile")
+			mode = PROFILE;
+		else if (name == "all")
+			mode = ALL;
+		else
+			return false;
+		return true;
+	}
+
+	bool PvdProbe(const PvdConfig& config)
+	{
+		//a plain TCP connect with the configured timeout, closed straight away
+		addrinfo hints = {}, *address = 0;
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		if (getaddrinfo(config.host.c_str(), std::to_string(config.port).c_str(), &hints, &address) != 0)
+			return false;
+
+		bool listening = false;
+		SOCKET sock = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (sock != INVALID_SOCKET)
+		{
+			u_long non_blocking = 1;
+			ioctlsocket(sock, FIONBIO, &non_blocking);
+			connect(sock, address->ai_addr, (int)address->ai_addrlen);
+
+			fd_set writable, failed;
+			FD_ZERO(&writable);
+			FD_ZERO(&failed);
+			FD_SET(sock, &writable);
+			FD_SET(sock, &failed);
+			timeval timeout = { (long)(config.timeout / 1000), (long)(config.timeout % 1000) * 1000 };
+			listening = select(0, 0, &writable, &failed, &timeout) > 0 && FD_ISSET(sock, &writable);
+			closesocket(sock);
+		}
+
+		freeaddrinfo(address);
+		return listening;
+	}
+
+	void PvdWorker(PvdConfig config)
+	{
+		WSADATA wsa;
+		if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+			return;
+
+		std::unique_lock<std::mutex> lock(pvd_mutex);
+		while (!pvd_stop)
+		{
+			//probes block for up to the timeout, so the lock is only held while waiting
+			lock.unlock();
+			if (!pvd_connected && !pvd_listening)
+				pvd_listening = PvdProbe(config);
+			lock.lock();
+
+			pvd_wake.wait_for(lock, std::chrono::milliseconds(config.retry_interval), [] { return pvd_stop; });
+		}
+
+		WSACleanup();
+	}
+
+	void PvdUpdate()
+	{
+		if (pvd_config.mode == PvdConfig::NONE)
+			return;
+
+		if (vd_connection && !vd_connection->isConnected())
+		{
+			vd_connection->release();
+			vd_connection = 0;
+		}
+
+		//only attempted once the worker has seen a listener, so this does not wait out the timeout while nothing is there
+		if (!vd_connection && pvd_listening)
+		{
+			PxVisualDebuggerConnectionFlags flags;
+			if (pvd_config.mode == PvdConfig::DEBUG)
+				flags = PxVisualDebuggerConnectionFlag::eDEBUG;
+			else if (pvd_config.mode == PvdConfig::PROFILE)
+				flags = PxVisualDebuggerConnectionFlag::ePROFILE;
+			else
+				flags = PxVisualDebuggerExt::getAllConnectionFlags();
+
+			vd_connection = PxVisualDebuggerExt::createConnection(physics->getPvdConnectionManager(),
+				pvd_config.host.c_str(), pvd_config.port, pvd_config.timeout, flags);
+			pvd_listening = false;
+		}
+
+		pvd_connected = vd_connection && vd_connection->isConnected();
+	}
+
+	void PvdConnect(const PvdConfig& config)
 	{
+		//stop any earlier worker and drop its connection before starting one with the new settings
+		if (pvd_thread.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(pvd_mutex);
+				pvd_stop = true;
+			}
+			pvd_wake.notify_all();
+			pvd_thread.join();
+		}
+
 		if (vd_connection)
 			vd_connection->release();
+		vd_connection = 0;
+		pvd_connected = false;
+		pvd_listening = false;
+
+		pvd_stop = false;
+		pvd_config = config;
+		if (config.mode != PvdConfig::NONE && physics)
+			pvd_thread = std::thread(PvdWorker, config);
+		else pvd_config.mode = PvdConfig::NONE;
+	}
+
+	bool PvdConnected()
+	{
+		return pvd_connected;
+	}
+
+	void PxRelease()
+	{
+		PvdConnect(PvdConfig());
 		if (cooking)
 			cooking->release();
 		if (physics) {
@@ -153,11 +297,26 @@ namespace PhysicsEngine
 		}
 	}
 
-	void Actor::SetupFiltering(PxU32 filterGroup, PxU32 filterMask, PxU32 shape_index)
+	void Actor::SetupFiltering(PxU32 filterGroup, PxU32 shape_index)
 	{
 		std::vector<PxShape*> shape_list = GetShapes(shape_index);
 		for (PxU32 i = 0; i < shape_list.size(); i++)
-			shape_list[i]->setSimulationFilterData(PxFilterData(filterGroup, filterMask,0,0));
+		{
+			shape_list[i]->setSimulationFilterData(PxFilterData(filterGroup,0,0,0));
+			//scene queries filter on the group alone, see BatchQuery
+			shape_list[i]->setQueryFilterData(PxFilterData(filterGroup,0,0,0));
+		}
+	}
+
+	void Actor::SetupRule(PxU32 rule, PxU32 shape_index)
+	{
+		std::vector<PxShape*> shape_list = GetShapes(shape_index);
+		for (PxU32 i = 0; i < shape_list.size(); i++)
+		{
+			PxFilterData data = shape_list[i]->getSimulationFilterData();
+			data.word3 = rule;
+			shape_list[i]->setSimulationFilterData(data);
+		}
 	}
 
 	void Actor::Name(const string& new_name)
@@ -175,6 +334,9 @@ namespace PhysicsEngine
 	{
 		actor = (PxActor*)GetPhysics()->createRigidDynamic(pose);
 		Name("");
+
+		//report transitions to the simulation callback's onWake and onSleep
+		actor->setActorFlag(PxActorFlag::eSEND_SLEEP_NOTIFIES, true);
 	}
 
 	DynamicActor::~DynamicActor()
@@ -198,6 +360,16 @@ namespace PhysicsEngine
 		((PxRigidDynamic*)actor)->setRigidDynamicFlag(PxRigidDynamicFlag::eKINEMATIC, value);
 	}
 
+	void DynamicActor::SleepThreshold(PxReal value)
+	{
+		((PxRigidDynamic*)actor)->setSleepThreshold(value);
+	}
+
+	void DynamicActor::StabilizationThreshold(PxReal value)
+	{
+		((PxRigidDynamic*)actor)->setStabilizationThreshold(value);
+	}
+
 	StaticActor::StaticActor(const PxTransform& pose)
 	{
 		actor = (PxActor*)GetPhysics()->createRigidStatic(pose);
@@ -219,6 +391,19 @@ namespace PhysicsEngine
 			((UserData*)GetShape(i)->userData)->color = &colors[i];
 	}
 
+	void StaticActor::ShapesCreated(PxU32 count)
+	{
+		//the colours may have moved when the vector grew, so every shape's pointer is refreshed
+		colors.resize(colors.size() + count, default_color);
+		std::vector<PxShape*> shapes = GetShapes();
+		for (unsigned int i = 0; i < shapes.size() && i < colors.size(); i++)
+		{
+			if (i + count >= colors.size())
+				shapes[i]->userData = new UserData();
+			((UserData*)shapes[i]->userData)->color = &colors[i];
+		}
+	}
+
 	///Scene methods
 	void Scene::Init()
 	{
@@ -231,8 +416,31 @@ namespace PhysicsEngine
 		}
 
 		sceneDesc.filterShader = filter_shader;
+		if (filter_shader_data.size())
+		{
+			sceneDesc.filterShaderData = &filter_shader_data.front();
+			sceneDesc.filterShaderDataSize = (PxU32)filter_shader_data.size();
+		}
 		
-		//sceneDesc.flags |= PxSceneFlag::eENABLE_CCD;
+		//CCD still has to be enabled per body and per pair, see CCDBody and UpdateCCD
+		if (config.ccd.mode != CCDPolicy::NONE)
+			sceneDesc.flags |= PxSceneFlag::eENABLE_CCD;
+
+		sceneDesc.broadPhaseType = config.broadphase;
+		sceneDesc.broadPhaseCallback = &bounds_callback;
+		sceneDesc.staticStructure = config.static_structure;
+		sceneDesc.dynamicStructure = config.dynamic_structure;
+		sceneDesc.dynamicTreeRebuildRateHint = config.dynamic_rebuild_rate;
+
+		//active transforms list exactly the actors which were awake during a step, this is how awake bodies are counted
+		sceneDesc.flags |= PxSceneFlag::eENABLE_ACTIVETRANSFORMS;
+
+		//PhysX 3.3 is deterministic for an identical sequence of API calls on a single dispatcher thread, 3.4 adds an
+		//enhanced mode which also makes results independent of actor insertion order
+#if PX_PHYSICS_VERSION_MAJOR > 3 || (PX_PHYSICS_VERSION_MAJOR == 3 && PX_PHYSICS_VERSION_MINOR >= 4)
+		if (config.deterministic)
+			sceneDesc.flags |= PxSceneFlag::eENABLE_ENHANCED_DETERMINISM;
+#endif
 
 		px_scene = GetPhysics()->createScene(sceneDesc);
 
@@ -241,6 +449,24 @@ namespace PhysicsEngine
 
 		px_scene->setGravity(PxVec3(0.0f, -9.81f, 0.0f));
 
+		bounds_callback.out_of_bounds = 0;
+		step_count = 0;
+		simulate_count = 0;
+		substepped_count = 0;
+		simulate_time.Reset();
+		awake_count = 0;
+		awake_total = 0;
+		ccd_bodies.clear();
+		ccd_state.clear();
+		ccd_offsets.clear();
+		ccd_extents.clear();
+		ccd_swept = 0;
+		ccd_swept_total = 0;
+
+		//regions are rebuilt once the custom scene reports its bounds
+		world_bounds = PxBounds3::empty();
+		region_handles.clear();
+
 		CustomInit();
 
 		pause = false;
@@ -255,10 +481,31 @@ namespace PhysicsEngine
 		if (pause)
 			return;
 
+		//connecting to PVD streams the scene, so it may only happen here between steps
+		PvdUpdate();
+
 		CustomUpdate();
 
-		px_scene->simulate(dt);
-		px_scene->fetchResults(true);
+		//a single update may be split into equal substeps, it still counts as one step and PostUpdate runs once
+		PxU32 substeps = PxClamp(Substeps(dt), 1u, PxMax(config.max_substeps, 1u));
+		if (substeps > 1)
+			substepped_count++;
+
+		UpdateCCD(dt);
+
+		step_count++;
+		Stopwatch timer;
+		for (PxU32 i = 0; i < substeps; i++)
+		{
+			CustomSubstep(i, substeps);
+			px_scene->simulate(dt / substeps);
+			px_scene->fetchResults(true);
+		}
+		simulate_count += substeps;
+		simulate_time.Add(timer.Elapsed());
+
+		px_scene->getActiveTransforms(awake_count);
+		awake_total += awake_count;
 
 		PostUpdate();
 	}
@@ -268,6 +515,300 @@ namespace PhysicsEngine
 		px_scene->addActor(*actor->Get());
 	}
 
+	void Scene::Remove(Actor* actor)
+	{
+		px_scene->removeActor(*actor->Get());
+	}
+
+	void Scene::Config(const SceneConfig& value)
+	{
+		config = value;
+	}
+
+	const SceneConfig& Scene::Config()
+	{
+		return config;
+	}
+
+	void Scene::FilterShaderData(const void* data, PxU32 size)
+	{
+		filter_shader_data.assign((const PxU8*)data, (const PxU8*)data + size);
+	}
+
+	void Scene::WorldBounds(const PxBounds3& bounds)
+	{
+		world_bounds = bounds;
+		world_bounds.fattenFast(config.bounds_margin);
+
+		if (px_scene->getBroadPhaseType() != PxBroadPhaseType::eMBP)
+			return;
+
+		//remove any regions from a previous call
+		for (unsigned int i = 0; i < region_handles.size(); i++)
+			px_scene->removeBroadPhaseRegion(region_handles[i]);
+		region_handles.clear();
+
+		//subdivide across the two largest axes, the smallest axis is treated as "up"
+		PxVec3 extents = world_bounds.getExtents();
+		PxU32 up_axis = (extents.x < extents.y) ? ((extents.x < extents.z) ? 0 : 2) : ((extents.y < extents.z) ? 1 : 2);
+
+		PxBroadPhaseCaps caps;
+		px_scene->getBroadPhaseCaps(caps);
+
+		PxU32 subdivisions = PxMax(config.mbp_subdivisions, 1u);
+		while (caps.maxNbRegions && subdivisions * subdivisions > caps.maxNbRegions)
+			subdivisions--;
+
+		std::vector<PxBounds3> regions(subdivisions*subdivisions);
+		PxU32 nb_regions = PxBroadPhaseExt::createRegionsFromWorldBounds(&regions.front(), world_bounds, subdivisions, up_axis);
+
+		//populate the new regions with any actors that were added before the bounds were known
+		for (PxU32 i = 0; i < nb_regions; i++)
+		{
+			PxBroadPhaseRegion region;
+			region.bounds = regions[i];
+			region.userData = 0;
+			region_handles.push_back(px_scene->addBroadPhaseRegion(region, true));
+		}
+	}
+
+	PxBounds3 Scene::WorldBounds()
+	{
+		return world_bounds;
+	}
+
+	PxU32 Scene::OutOfBoundsCount()
+	{
+		return bounds_callback.out_of_bounds;
+	}
+
+	PxU32 Scene::StepCount()
+	{
+		return step_count;
+	}
+
+	PxU32 Scene::SimulateCount()
+	{
+		return simulate_count;
+	}
+
+	PxU32 Scene::SubsteppedCount()
+	{
+		return substepped_count;
+	}
+
+	const ProfileCounter& Scene::SimulateTime()
+	{
+		return simulate_time;
+	}
+
+	enum CCDState : PxU8
+	{
+		CCD_OFF,
+		CCD_SPECULATIVE,
+		CCD_SWEPT,
+		CCD_UNKNOWN
+	};
+
+	void Scene::CCDBody(PxRigidDynamic* body)
+	{
+		PxShape* shapes[8];
+		PxU32 nb_shapes = body->getShapes(shapes, 8);
+
+		//how far the body's surface reaches from its centre of mass, which turns its angular speed into the speed of its
+		//furthest point. A sphere turning about its own centre sweeps nothing new, so only its centre's offset counts
+		PxTransform cmass = body->getCMassLocalPose();
+		PxReal extent = 0.f;
+		for (PxU32 i = 0; i < nb_shapes; i++)
+		{
+			PxTransform pose = cmass.transformInv(shapes[i]->getLocalPose());
+			if (shapes[i]->getGeometryType() == PxGeometryType::eSPHERE)
+				extent = PxMax(extent, pose.p.magnitude());
+			else
+			{
+				PxBounds3 bounds = PxGeometryQuery::getWorldBounds(shapes[i]->getGeometry().any(), pose, 1.f);
+				extent = PxMax(extent, bounds.minimum.abs().maximum(bounds.maximum.abs()).magnitude());
+			}
+		}
+
+		ccd_bodies.push_back(body);
+		ccd_state.push_back(CCD_UNKNOWN);
+		ccd_offsets.push_back(nb_shapes ? shapes[0]->getContactOffset() : 0.f);
+		ccd_extents.push_back(extent);
+	}
+
+	void Scene::UpdateCCD(PxReal dt)
+	{
+		//choose a mode for each body from its speed, flags are only touched when a body changes mode
+		ccd_swept = 0;
+		for (unsigned int i = 0; i < ccd_bodies.size(); i++)
+		{
+			PxRigidDynamic* body = ccd_bodies[i];
+			if (body->getScene() != px_scene)
+				continue;
+
+			PxU8 state = CCD_OFF;
+			if (config.ccd.mode == CCDPolicy::ALWAYS)
+				state = CCD_SWEPT;
+			else if (config.ccd.mode == CCDPolicy::ADAPTIVE)
+			{
+				//the speed of the body's furthest point, so a flipper is judged by its tip rather than its barely moving centre
+				PxReal speed = body->getLinearVelocity().magnitude() + body->getAngularVelocity().magnitude() * ccd_extents[i];
+				state = (speed > config.ccd.swept_speed) ? CCD_SWEPT : (speed > config.ccd.speculative_speed) ? CCD_SPECULATIVE : CCD_OFF;
+			}
+
+			if (state == CCD_SWEPT)
+				ccd_swept++;
+
+			if (state == ccd_state[i])
+				continue;
+			ccd_state[i] = state;
+
+			body->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_CCD, state == CCD_SWEPT);
+
+#if PX_PHYSICS_VERSION_MAJOR > 3 || (PX_PHYSICS_VERSION_MAJOR == 3 && PX_PHYSICS_VERSION_MINOR >= 4)
+			body->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_SPECULATIVE_CCD, state == CCD_SPECULATIVE);
+#else
+			//3.3 has no speculative CCD, the nearest equivalent is widening the contact offset by the furthest a body below
+			//the swept threshold can move in one step, so contacts are generated before it gets there
+			PxReal margin = (state == CCD_SPECULATIVE) ? config.ccd.swept_speed * dt : 0.f;
+			PxShape* shapes[8];
+			PxU32 nb_shapes = body->getShapes(shapes, 8);
+			for (PxU32 j = 0; j < nb_shapes; j++)
+				shapes[j]->setContactOffset(ccd_offsets[i] + margin);
+#endif
+		}
+
+		ccd_swept_total += ccd_swept;
+	}
+
+	PxU32 Scene::CCDSweptCount()
+	{
+		return ccd_swept;
+	}
+
+	PxReal Scene::CCDSweptAverage()
+	{
+		return step_count ? (PxReal)((double)ccd_swept_total / step_count) : 0.f;
+	}
+
+	PxU32 Scene::AwakeCount()
+	{
+		return awake_count;
+	}
+
+	PxReal Scene::AwakeAverage()
+	{
+		return step_count ? (PxReal)((double)awake_total / step_count) : 0.f;
+	}
+
+	PxU64 Scene::StateHash()
+	{
+		//FNV-1a over the raw bits of each dynamic actor's state, in scene order
+		PxU64 hash = 14695981039346656037ULL;
+		std::vector<PxRigidDynamic*> actors(px_scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC));
+		if (actors.size())
+			px_scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, (PxActor**)&actors.front(), (PxU32)actors.size());
+
+		for (unsigned int i = 0; i < actors.size(); i++)
+		{
+			PxTransform pose = actors[i]->getGlobalPose();
+			PxVec3 linear = actors[i]->getLinearVelocity(), angular = actors[i]->getAngularVelocity();
+			PxReal state[13] = { pose.p.x, pose.p.y, pose.p.z, pose.q.x, pose.q.y, pose.q.z, pose.q.w,
+				linear.x, linear.y, linear.z, angular.x, angular.y, angular.z };
+			const PxU8* bytes = (const PxU8*)state;
+			for (unsigned int j = 0; j < sizeof(state); j++)
+				hash = (hash ^ bytes[j]) * 1099511628211ULL;
+		}
+
+		return hash;
+	}
+
+	void Scene::Save(SceneState& state)
+	{
+		//the state's vectors are reused, so after the first save this only allocates when the scene grows
+		state.step = step_count;
+
+		PxU32 nb_actors = px_scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+		if (state_actors.size() < nb_actors)
+			state_actors.resize(nb_actors);
+		if (nb_actors)
+			px_scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, &state_actors.front(), nb_actors);
+
+		state.bodies.resize(nb_actors);
+		for (PxU32 i = 0; i < nb_actors; i++)
+		{
+			SceneState::Body& body = state.bodies[i];
+			body.actor = (PxRigidDynamic*)state_actors[i];
+			body.pose = body.actor->getGlobalPose();
+			body.linear_velocity = body.actor->getLinearVelocity();
+			body.angular_velocity = body.actor->getAngularVelocity();
+			body.sleeping = body.actor->isSleeping();
+		}
+
+		//joints are only reachable through their constraints, only the drives that gameplay changes are kept
+		PxU32 nb_constraints = px_scene->getNbConstraints();
+		if (state_constraints.size() < nb_constraints)
+			state_constraints.resize(nb_constraints);
+		if (nb_constraints)
+			px_scene->getConstraints(&state_constraints.front(), nb_constraints);
+
+		state.joints.clear();
+		for (PxU32 i = 0; i < nb_constraints; i++)
+		{
+			PxU32 type;
+			PxJoint* joint = (PxJoint*)state_constraints[i]->getExternalReference(type);
+			if (type != PxConstraintExtIDs::eJOINT)
+				continue;
+
+			SceneState::Joint saved = { joint, 0.f };
+			if (joint->getConcreteType() == PxJointConcreteType::eREVOLUTE)
+				saved.value = ((PxRevoluteJoint*)joint)->getDriveVelocity();
+			else if (joint->getConcreteType() == PxJointConcreteType::eDISTANCE)
+				saved.value = ((PxDistanceJoint*)joint)->getStiffness();
+			else continue;
+
+			state.joints.push_back(saved);
+		}
+	}
+
+	void Scene::Load(const SceneState& state)
+	{
+		step_count = state.step;
+
+		for (unsigned int i = 0; i < state.bodies.size(); i++)
+		{
+			const SceneState::Body& body = state.bodies[i];
+			if (body.actor->getScene() != px_scene)
+				continue;
+
+			body.actor->setGlobalPose(body.pose, false);
+			if (body.sleeping)
+			{
+				body.actor->putToSleep();
+				continue;
+			}
+
+			body.actor->setLinearVelocity(body.linear_velocity, false);
+			body.actor->setAngularVelocity(body.angular_velocity, false);
+			body.actor->wakeUp();
+		}
+
+		for (unsigned int i = 0; i < state.joints.size(); i++)
+		{
+			const SceneState::Joint& saved = state.joints[i];
+			if (saved.joint->getConcreteType() == PxJointConcreteType::eREVOLUTE)
+				((PxRevoluteJoint*)saved.joint)->setDriveVelocity(saved.value);
+			else ((PxDistanceJoint*)saved.joint)->setStiffness(saved.value);
+		}
+	}
+
+	void BoundsCallback::onObjectOutOfBounds(PxShape& shape, PxActor& actor)
+	{
+		if (!out_of_bounds++)
+			cerr << "PhysicsEngine::BoundsCallback, an actor has left the broadphase regions and will no longer collide." << endl;
+	}
+
 	PxScene* Scene::Get() 
 	{ 
 		return px_scene; 
@@ -275,10 +816,23 @@ namespace PhysicsEngine
 
 	void Scene::Reset()
 	{
+		CustomRelease();
 		px_scene->release();
 		Init();
 	}
 
+	void Scene::Release()
+	{
+		CustomRelease();
+
+		std::vector<PxActor*> actors = GetAllActors();
+		for (unsigned int i = 0; i < actors.size(); i++)
+			actors[i]->release();
+
+		px_scene->release();
+		px_scene = 0;
+	}
+
 	void Scene::Pause(bool value)
 	{
 		pause = value;
@@ -3,7 +3,8 @@
 #include <vector>
 #include "PxPhysicsAPI.h"
 #include "Exception.h"
-#include "Extras\UserData.h"
+#include "Extras/UserData.h"
+#include "Extras/Profiler.h"
 #include <string>
 
 namespace PhysicsEngine
@@ -15,6 +16,39 @@ namespace PhysicsEngine
 
 	void PxRelease();
 
+	///Which data is streamed to the PhysX Visual Debugger, nothing is connected to unless PvdConnect is called
+	struct PvdConfig
+	{
+		enum Mode
+		{
+			NONE,				//no connection and no socket calls
+			DEBUG,				//scene objects and their state every step
+			PROFILE,			//profiling zones only
+			ALL					//debug, profile and memory data
+		};
+
+		Mode mode;
+		string host;
+		PxU32 port;
+		PxU32 timeout;				//ms each probe may take on the background thread, and the connection once something listens
+		PxU32 retry_interval;		//ms between attempts while nothing is listening or after a disconnect
+
+		PvdConfig(Mode _mode=NONE, const string& _host="localhost", PxU32 _port=5425, PxU32 _timeout=100, PxU32 _retry_interval=2000)
+			: mode(_mode), host(_host), port(_port), timeout(_timeout), retry_interval(_retry_interval) {}
+
+		///Parse "none", "debug", "profile" or "all", returns false for anything else
+		static bool Parse(const string& name, Mode& mode);
+	};
+
+	///Start (or with NONE stop) looking for PVD on a background thread, reconnecting whenever the connection drops
+	void PvdConnect(const PvdConfig& config);
+
+	///Connect to PVD once the background thread has found it listening, or release a dropped connection. This touches
+	///the scenes, so it is only called between steps on the thread which simulates them, see Scene::Update
+	void PvdUpdate();
+
+	bool PvdConnected();
+
 	PxPhysics* GetPhysics();
 
 	PxCooking* GetCooking();
@@ -25,6 +59,8 @@ namespace PhysicsEngine
 
 	static const PxVec3 default_color(.8f,.8f,.8f);
 
+	class BatchQuery;
+
 	class Actor
 	{
 	protected:
@@ -58,7 +94,12 @@ namespace PhysicsEngine
 
 		void SetTrigger(bool value, PxU32 index=-1);
 
-		void SetupFiltering(PxU32 filterGroup, PxU32 filterMask, PxU32 shape_index=-1);
+		///Put the shapes in a filter group, kept in word0. What each pair of groups does is decided by the scene's filter
+		///shader, see TableRules, so there is no per-shape mask
+		void SetupFiltering(PxU32 filterGroup, PxU32 shape_index=-1);
+
+		///Tag the shapes with a scoring rule id, kept in word3 of the simulation filter data. Call after SetupFiltering.
+		void SetupRule(PxU32 rule, PxU32 shape_index=-1);
 	};
 
 	class DynamicActor : public Actor
@@ -71,6 +112,12 @@ namespace PhysicsEngine
 		void CreateShape(const PxGeometry& geometry, PxReal density);
 
 		void SetKinematic(bool value, PxU32 index=-1);
+
+		///Mass-normalised kinetic energy below which the actor may fall asleep
+		void SleepThreshold(PxReal value);
+
+		///Mass-normalised kinetic energy below which the actor's motion is damped to help it settle
+		void StabilizationThreshold(PxReal value);
 	};
 
 	class StaticActor : public Actor
@@ -81,6 +128,96 @@ namespace PhysicsEngine
 		~StaticActor();
 
 		void CreateShape(const PxGeometry& geometry, PxReal density=0.f);
+
+		///Create count shapes at once, reading each geometry and local pose from strided arrays as the PhysX descriptors do
+		template <typename Geometry>
+		void CreateShapes(const Geometry* geometry, PxU32 geometry_stride, const PxTransform* local_pose, PxU32 pose_stride, PxU32 count)
+		{
+			for (PxU32 i = 0; i < count; i++)
+				((PxRigidStatic*)actor)->createShape(*(const Geometry*)((const PxU8*)geometry + i*geometry_stride), *GetMaterial(),
+					*(const PxTransform*)((const PxU8*)local_pose + i*pose_stride));
+			ShapesCreated(count);
+		}
+
+	private:
+		///Colour and user data bookkeeping for the last count shapes, done once rather than per shape
+		void ShapesCreated(PxU32 count);
+	};
+
+	///Which bodies registered with Scene::CCDBody use continuous collision detection, re-evaluated before every update
+	struct CCDPolicy
+	{
+		enum Mode
+		{
+			NONE,				//no CCD at all, CCD is also disabled on the scene
+			ALWAYS,				//swept CCD on every registered body
+			ADAPTIVE			//swept CCD only above swept_speed, speculative contacts above speculative_speed, judged on the speed of
+								//the body's furthest point so a flipper swinging about its hinge is swept by the speed of its tip
+		};
+
+		Mode mode;
+		PxReal swept_speed;			//m/s
+		PxReal speculative_speed;	//m/s
+
+		CCDPolicy(Mode _mode=ALWAYS, PxReal _swept_speed=10.f, PxReal _speculative_speed=3.f)
+			: mode(_mode), swept_speed(_swept_speed), speculative_speed(_speculative_speed) {}
+	};
+
+	///Broadphase and pruning options applied when the scene is created, and substepping limits used on every update
+	struct SceneConfig
+	{
+		PxBroadPhaseType::Enum broadphase;
+		PxPruningStructure::Enum static_structure;
+		PxPruningStructure::Enum dynamic_structure;
+		PxU32 dynamic_rebuild_rate;
+		PxU32 mbp_subdivisions;		//regions per axis when deriving multi-box pruning regions from the world bounds
+		PxReal bounds_margin;		//padding added to the world bounds on every axis
+		bool deterministic;			//request enhanced determinism where the SDK supports it (3.4+)
+		PxU32 max_substeps;			//most simulate calls a single update may be split into, 1 disables substepping
+		PxReal substep_speed;		//speed (m/s) above which a ball needs substeps, negative to always substep
+		CCDPolicy ccd;				//whether CCD is enabled on the scene is fixed on Init, the rest applies every update
+
+		SceneConfig(PxBroadPhaseType::Enum _broadphase=PxBroadPhaseType::eSAP, PxU32 _mbp_subdivisions=4, PxReal _bounds_margin=2.f)
+			: broadphase(_broadphase), static_structure(PxPruningStructure::eSTATIC_AABB_TREE), dynamic_structure(PxPruningStructure::eDYNAMIC_AABB_TREE),
+			dynamic_rebuild_rate(100), mbp_subdivisions(_mbp_subdivisions), bounds_margin(_bounds_margin), deterministic(false),
+			max_substeps(4), substep_speed(8.f) {}
+	};
+
+	///Counts actors which leave the multi-box pruning regions, these no longer collide until they return
+	class BoundsCallback : public PxBroadPhaseCallback
+	{
+	public:
+		PxU32 out_of_bounds;
+
+		BoundsCallback() : out_of_bounds(0) {}
+
+		void onObjectOutOfBounds(PxShape& shape, PxActor& actor);
+
+		void onObjectOutOfBounds(PxAggregate& aggregate) { out_of_bounds++; }
+	};
+
+	///Everything about a Scene that changes while it simulates, captured by Scene::Save and restored by Scene::Load.
+	///Bodies and joints are referenced directly, so a state only applies to the scene it was saved from.
+	struct SceneState
+	{
+		struct Body
+		{
+			PxRigidDynamic* actor;
+			PxTransform pose;
+			PxVec3 linear_velocity;
+			PxVec3 angular_velocity;
+			bool sleeping;
+		};
+
+		struct Joint
+		{
+			PxJoint* joint;
+			PxReal value;			//drive velocity of a revolute joint, or stiffness of a distance joint
+		};
+
+		PxU32 step;
+		std::vector<Body> bodies;
+		std::vector<Joint> joints;
 	};
 
 	class Scene
@@ -91,30 +228,118 @@ namespace PhysicsEngine
 		PxRigidDynamic* selected_actor;
 		std::vector<PxVec3> sactor_color_orig;
 		PxSimulationFilterShader filter_shader;
+		std::vector<PxU8> filter_shader_data;
+		SceneConfig config;
+		BoundsCallback bounds_callback;
+		PxBounds3 world_bounds;
+		std::vector<PxU32> region_handles;
+		PxU32 step_count;
+		std::vector<PxActor*> state_actors;			//scratch buffers for Save, kept to avoid allocating every step
+		std::vector<PxConstraint*> state_constraints;
+		PxU32 simulate_count;
+		PxU32 substepped_count;
+		ProfileCounter simulate_time;
+		PxU32 awake_count;
+		PxU64 awake_total;
+		std::vector<PxRigidDynamic*> ccd_bodies;
+		std::vector<PxU8> ccd_state;				//current CCDState of each registered body
+		std::vector<PxReal> ccd_offsets;			//contact offset of each registered body's shapes when it was registered
+		std::vector<PxReal> ccd_extents;			//furthest a registered body's surface reaches from its centre of mass
+		PxU32 ccd_swept;
+		PxU64 ccd_swept_total;
+
+		void UpdateCCD(PxReal dt);
 
 		void HighlightOn(PxRigidDynamic* actor);
 
 		void HighlightOff(PxRigidDynamic* actor);
 
 	public:
-		Scene(PxSimulationFilterShader custom_filter_shader=PxDefaultSimulationFilterShader) : filter_shader(custom_filter_shader) {}
+		Scene(PxSimulationFilterShader custom_filter_shader=PxDefaultSimulationFilterShader) : filter_shader(custom_filter_shader), world_bounds(PxBounds3::empty()) {}
 
 		void Init();
 
+		///Set the broadphase and pruning configuration, this takes effect on the next Init or Reset
+		void Config(const SceneConfig& value);
+
+		const SceneConfig& Config();
+
+		///Set the constant block passed to the filter shader, this is copied and takes effect on the next Init or Reset
+		void FilterShaderData(const void* data, PxU32 size);
+
+		///Set the extents that all actors are expected to stay within, with multi-box pruning this also rebuilds the regions
+		void WorldBounds(const PxBounds3& bounds);
+
+		PxBounds3 WorldBounds();
+
+		PxU32 OutOfBoundsCount();
+
+		///Number of simulation steps taken since Init
+		PxU32 StepCount();
+
+		///Number of simulate calls since Init, this is larger than StepCount when updates have been substepped
+		PxU32 SimulateCount();
+
+		///Number of updates which were split into more than one simulate call
+		PxU32 SubsteppedCount();
+
+		///Time spent in simulate and fetchResults for each update, across all of its substeps
+		const ProfileCounter& SimulateTime();
+
+		///Put a body under the scene's CCD policy, bodies are forgotten on Init or Reset
+		void CCDBody(PxRigidDynamic* body);
+
+		///Number of registered bodies using swept CCD during the last update
+		PxU32 CCDSweptCount();
+
+		///Average number of registered bodies using swept CCD per update since Init
+		PxReal CCDSweptAverage();
+
+		///Number of dynamic actors which were awake during the last update
+		PxU32 AwakeCount();
+
+		///Average number of awake dynamic actors per update since Init
+		PxReal AwakeAverage();
+
+		///Hash of every dynamic actor's pose and velocities, identical hashes mean identical simulation state
+		PxU64 StateHash();
+
+		///Capture the pose, velocities and sleep state of every dynamic actor and the drive of every joint
+		void Save(SceneState& state);
+
+		///Restore a state saved from this scene, bodies which have since left the scene are skipped
+		void Load(const SceneState& state);
+
 		virtual void CustomInit() {}
 
+		///Called by Reset and Release while the scene still exists, to free anything CustomInit created which is not simply
+		///released with the scene's actors
+		virtual void CustomRelease() {}
+
 		void Update(PxReal dt);
 
 		virtual void CustomUpdate() {}
 
+		///Number of simulate calls the next update should be split into, called once per update after CustomUpdate
+		virtual PxU32 Substeps(PxReal dt) { return 1; }
+
+		///Called before every simulate call, including each substep, for input which must be applied continuously or at
+		///the point within the step it happened
+		virtual void CustomSubstep(PxU32 substep, PxU32 substeps) {}
+
 		virtual void PostUpdate() {}
 
 		void Add(Actor* actor);
 
+		void Remove(Actor* actor);
+
 		PxScene* Get();
 
 		void Reset();
 
+		///Release every actor in the scene and the scene itself, after CustomRelease
+		void Release();
+
 		void Pause(bool value);
 
 		bool Pause();
@@ -124,6 +349,9 @@ namespace PhysicsEngine
 		void SelectNextActor();
 
 		std::vector<PxActor*> GetAllActors();
+
+		///Create a batch of scene queries with preallocated result buffers, see BatchQuery
+		BatchQuery* CreateBatchQuery(PxU32 max_raycasts, PxU32 max_sweeps=0, PxU32 max_overlaps=0, PxU32 max_touches_per_query=0, PxU32 threads=1);
 	};
 
 	class Joint
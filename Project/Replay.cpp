@@ -0,0 +1,216 @@
+#include "Replay.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstddef>
+#include "MyPhysicsEngine.h"
+#include "Extras/Profiler.h"
+
+using namespace physx;
+
+static const char RECORDING_MAGIC[4] = { 'P', 'B', 'R', 'P' };
+static const PxU32 RECORDING_VERSION = 3;			// Version 2 added each event's phase, version 1 events have a phase of 0.
+													// Version 3 added the rules hash to the header.
+
+Recording::Recording(PxReal stepTime, PxU32 multiballCapacity, PxU64 rulesHash)
+{
+	memcpy(_header.magic, RECORDING_MAGIC, 4);
+	_header.version = RECORDING_VERSION;
+	_header.stepTime = stepTime;
+	_header.multiballCapacity = multiballCapacity;
+	_header.rulesHash = rulesHash;
+
+	Clear();
+}
+
+void Recording::Record(PxU32 step, InputAction action, PxU8 phase)
+{
+	InputEvent e = { step, action, phase };
+	_events.push_back(e);
+}
+
+void Recording::Finish(PxU32 steps, PxI32 score, PxU64 stateHash)
+{
+	_trailer.steps = steps;
+	_trailer.score = score;
+	_trailer.stateHash = stateHash;
+}
+
+void Recording::Clear()
+{
+	_events.clear();
+	_trailer.steps = 0;
+	_trailer.score = 0;
+	_trailer.stateHash = 0;
+}
+
+bool Recording::Save(const std::string& path) const
+{
+	// The stream is the header, the event count, then each event as a variable-length step delta followed by an action
+	// byte and a phase byte, and finally the trailer. Most events are a few frames apart, so an event is usually three bytes.
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "Recording (path=" << path << ") could not be opened for writing." << std::endl;
+		return false;
+	}
+
+	PxU32 count = (PxU32)_events.size();
+	file.write((const char*)&_header, sizeof(Header));
+	file.write((const char*)&count, sizeof(count));
+
+	PxU32 previous = 0;
+	for (PxU32 i = 0; i < count; i++)
+	{
+		PxU32 delta = _events[i].step - previous;
+		previous = _events[i].step;
+
+		// 7 bits per byte, with the high bit set on every byte except the last.
+		while (delta >= 0x80)
+		{
+			file.put((char)((delta & 0x7F) | 0x80));
+			delta >>= 7;
+		}
+		file.put((char)delta);
+		file.put((char)_events[i].action);
+		file.put((char)_events[i].phase);
+	}
+
+	file.write((const char*)&_trailer, sizeof(Trailer));
+	return file.good();
+}
+
+bool Recording::Load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "Recording (path=" << path << ") could not be opened." << std::endl;
+		return false;
+	}
+
+	// Headers before version 3 end where the rules hash starts.
+	PxU32 count = 0;
+	_header.rulesHash = 0;
+	file.read((char*)&_header, offsetof(Header, rulesHash));
+	if (_header.version >= 3)
+		file.read((char*)&_header.rulesHash, sizeof(_header.rulesHash));
+	file.read((char*)&count, sizeof(count));
+
+	if (!file.good() || memcmp(_header.magic, RECORDING_MAGIC, 4) != 0 || _header.version < 1 || _header.version > RECORDING_VERSION)
+	{
+		std::cerr << "Recording (path=" << path << ") is not a valid recording." << std::endl;
+		return false;
+	}
+
+	_events.resize(count);
+
+	PxU32 step = 0;
+	for (PxU32 i = 0; i < count; i++)
+	{
+		PxU32 delta = 0;
+		for (PxU32 shift = 0; ; shift += 7)
+		{
+			int byte = file.get();
+			if (byte == EOF || shift > 28)
+				return false;
+
+			delta |= (PxU32)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				break;
+		}
+
+		step += delta;
+		_events[i].step = step;
+		_events[i].action = (InputAction)file.get();
+		_events[i].phase = (_header.version >= 2) ? (PxU8)file.get() : 0;
+	}
+
+	file.read((char*)&_trailer, sizeof(Trailer));
+	return file.good();
+}
+
+namespace Replay
+{
+	PhysicsEngine::SceneConfig SceneConfig()
+	{
+		PhysicsEngine::SceneConfig config;
+		config.deterministic = true;
+		return config;
+	}
+
+	bool Verify(const std::string& path, bool verbose)
+	{
+		Recording recording;
+		if (!recording.Load(path))
+			return false;
+
+		// Scoring depends on the rules, so a game recorded under other rules can never match. Older recordings have no hash.
+		if (recording.header().rulesHash && recording.header().rulesHash != Game::Instance().rules().Hash())
+		{
+			if (verbose)
+				std::cout << path << ": MISMATCH (recorded under different scoring rules)" << std::endl;
+			return false;
+		}
+
+		// Start from the same game state as a freshly launched game, without scheduling a player reset.
+		Game::Instance().Reset(false);
+
+		PhysicsEngine::MyScene* scene = new PhysicsEngine::MyScene(recording.header().multiballCapacity);
+		scene->Config(SceneConfig());
+		scene->Init();
+
+		// Feed each recorded action into the scene at the step it was originally applied, then step the scene with no
+		// rendering or frame pacing.
+		const std::vector<InputEvent>& events = recording.events();
+		unsigned int next = 0;
+
+		while (scene->StepCount() < recording.trailer().steps)
+		{
+			while (next < events.size() && events[next].step == scene->StepCount())
+			{
+				scene->Queue(events[next].action, events[next].phase);
+				next++;
+			}
+
+			scene->Update(recording.header().stepTime);
+		}
+
+		PxI32 score = Game::Instance().score();
+		PxU64 hash = scene->StateHash();
+		bool match = (score == recording.trailer().score) && (hash == recording.trailer().stateHash);
+
+		if (verbose)
+		{
+			std::cout << path << ": " << (match ? "OK" : "MISMATCH") << " (steps=" << recording.trailer().steps << ", score=" << score;
+			if (score != recording.trailer().score)
+				std::cout << ", recorded score=" << recording.trailer().score;
+			if (hash != recording.trailer().stateHash)
+				std::cout << ", state hash differs";
+			std::cout << ")" << std::endl;
+		}
+
+		scene->Release();
+		delete scene;
+		return match;
+	}
+
+	int Run(const std::vector<std::string>& paths)
+	{
+		PhysicsEngine::PxInit();
+
+		Stopwatch timer;
+		int failed = 0;
+		for (unsigned int i = 0; i < paths.size(); i++)
+			if (!Verify(paths[i]))
+				failed++;
+
+		double seconds = timer.Elapsed() / 1000.0;
+		std::cout << paths.size() - failed << "/" << paths.size() << " recordings verified in " << std::fixed << std::setprecision(2) << seconds
+			<< "s (" << (seconds > 0.0 ? paths.size() * 3600.0 / seconds : 0.0) << " per hour)." << std::endl;
+
+		PhysicsEngine::PxRelease();
+		return failed;
+	}
+}
\ No newline at end of file
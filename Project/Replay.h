@@ -0,0 +1,64 @@
+#ifndef replay_h
+#define replay_h
+
+#include <string>
+#include <vector>
+#include "Input.h"
+#include "PhysicsEngine.h"
+
+/// <summary>
+/// A recorded game, consisting of every input action with the step at which it was applied and a summary of the final
+/// game state which a replay must reproduce.
+/// </summary>
+class Recording
+{
+	public:
+		struct Header
+		{
+			char magic[4];
+			physx::PxU32 version;
+			physx::PxReal stepTime;					// Fixed simulation step used for the whole game.
+			physx::PxU32 multiballCapacity;			// Pool size, this changes actor creation order and so must match.
+			physx::PxU64 rulesHash;					// ScoringRules::Hash of the rules played under, 0 before version 3.
+		};
+
+		struct Trailer
+		{
+			physx::PxU32 steps;
+			physx::PxI32 score;
+			physx::PxU64 stateHash;					// Scene::StateHash after the final step.
+		};
+
+	private:
+		Header _header;
+		Trailer _trailer;
+		std::vector<InputEvent> _events;
+
+	public:
+		Recording(physx::PxReal stepTime = 1.f / 60.f, physx::PxU32 multiballCapacity = 8, physx::PxU64 rulesHash = 0);
+
+		void Record(physx::PxU32 step, InputAction action, physx::PxU8 phase = 0);
+		void Finish(physx::PxU32 steps, physx::PxI32 score, physx::PxU64 stateHash);
+		void Clear();
+
+		bool Save(const std::string& path) const;
+		bool Load(const std::string& path);
+
+		const Header& header() const { return _header; }
+		const Trailer& trailer() const { return _trailer; }
+		const std::vector<InputEvent>& events() const { return _events; }
+};
+
+namespace Replay
+{
+	// The scene configuration for any game which may be recorded, a recording only verifies on a scene configured the same.
+	PhysicsEngine::SceneConfig SceneConfig();
+
+	// Replay a recording on a headless scene as fast as possible and compare the result against its trailer.
+	bool Verify(const std::string& path, bool verbose = true);
+
+	// Verify each recording in turn and report the throughput, returns the number of recordings which failed.
+	int Run(const std::vector<std::string>& paths);
+}
+
+#endif
\ No newline at end of file
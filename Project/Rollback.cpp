@@ -0,0 +1,146 @@
+#include "Rollback.h"
+
+using namespace physx;
+
+static const PxU32 NO_REWIND = 0xFFFFFFFF;
+
+Rollback::Rollback(PhysicsEngine::MyScene* scene, PxU32 window)
+	: _scene(scene), _rewind(NO_REWIND)
+{
+	// Snapshots are reused in place, after the first pass around the ring saving one does not allocate.
+	_snapshots.resize(PxMax(window, 2u));
+	for (PxU32 i = 0; i < _snapshots.size(); i++)
+		_snapshots[i].scene.step = NO_REWIND;
+}
+
+void Rollback::Input(PxU32 step, InputAction action, PxU8 phase)
+{
+	PxU32 current = _scene->StepCount();
+
+	// Input older than the oldest snapshot can no longer be placed exactly, so it is applied as early as possible.
+	PxU32 oldest = current >= Window() - 1 ? current - (Window() - 1) : 0;
+	if (step < oldest)
+	{
+		step = oldest;
+		_tooLate++;
+	}
+
+	// Keep the input in step order, after anything already received for the same step.
+	InputEvent e = { step, action, phase };
+	unsigned int i = (unsigned int)_inputs.size();
+	while (i > 0 && _inputs[i - 1].step > step)
+		i--;
+	_inputs.insert(_inputs.begin() + i, e);
+
+	if (step < current && step < _rewind)
+		_rewind = step;
+}
+
+void Rollback::Simulate(PxReal dt)
+{
+	PxU32 step = _scene->StepCount();
+
+	Stopwatch timer;
+	_scene->SaveSnapshot(_snapshots[step % Window()]);
+	saveTime.Add(timer.Elapsed());
+
+	for (unsigned int i = 0; i < _inputs.size() && _inputs[i].step <= step; i++)
+		if (_inputs[i].step == step)
+			_scene->Queue(_inputs[i].action, _inputs[i].phase);
+
+	_scene->Update(dt);
+}
+
+void Rollback::Step(PxReal dt)
+{
+	if (_scene->Pause())
+		return;
+
+	PxU32 current = _scene->StepCount();
+
+	if (_rewind != NO_REWIND)
+	{
+		// Return to the state before the earliest late input and replay every step since, the snapshots of those steps
+		// are overwritten as they are resimulated.
+		const PhysicsEngine::MyScene::Snapshot& snapshot = _snapshots[_rewind % Window()];
+		if (snapshot.scene.step == _rewind)
+		{
+			Stopwatch timer;
+			_scene->LoadSnapshot(snapshot);
+			loadTime.Add(timer.Elapsed());
+
+			// Telemetry and recordings have already been written for these steps, so both are detached while they are
+			// resimulated. The game shares the scene's telemetry stream, see VisualDebugger::StreamTelemetry.
+			Telemetry::Writer* telemetry = _scene->telemetry;
+			Recording* recording = _scene->recording;
+			_scene->telemetry = nullptr;
+			_scene->recording = nullptr;
+			if (telemetry)
+				Game::Instance().telemetry(nullptr);
+
+			timer.Start();
+			while (_scene->StepCount() < current)
+			{
+				Simulate(dt);
+				_resimulated++;
+			}
+			resimulateTime.Add(timer.Elapsed());
+
+			_scene->telemetry = telemetry;
+			_scene->recording = recording;
+			if (telemetry)
+				Game::Instance().telemetry(telemetry);
+
+			_rollbacks++;
+		}
+		_rewind = NO_REWIND;
+	}
+
+	Simulate(dt);
+
+	// Forget input for steps which have left the window.
+	PxU32 oldest = _scene->StepCount() >= Window() ? _scene->StepCount() - Window() : 0;
+	unsigned int expired = 0;
+	while (expired < _inputs.size() && _inputs[expired].step < oldest)
+		expired++;
+	if (expired)
+		_inputs.erase(_inputs.begin(), _inputs.begin() + expired);
+}
+
+void Rollback::Reset()
+{
+	for (PxU32 i = 0; i < _snapshots.size(); i++)
+		_snapshots[i].scene.step = NO_REWIND;
+
+	_inputs.clear();
+	_rewind = NO_REWIND;
+}
+
+void LoopbackChannel::Send(PxU32 step, InputAction action, PxU8 phase)
+{
+	PxU32 delay = _latency;
+	if (_jitter)
+	{
+		// A small LCG keeps the jitter reproducible for a given seed.
+		_seed = _seed * 1664525u + 1013904223u;
+		delay += (_seed >> 16) % (_jitter + 1);
+	}
+
+	// Packets never overtake each other, as with an ordered stream.
+	PxU32 deliverAt = step + delay;
+	if (!_inFlight.empty())
+		deliverAt = PxMax(deliverAt, _inFlight.back().deliverAt);
+
+	Packet packet = { deliverAt, { step, action, phase } };
+	_inFlight.push_back(packet);
+}
+
+void LoopbackChannel::Receive(PxU32 step, std::vector<InputEvent>& received)
+{
+	unsigned int delivered = 0;
+	while (delivered < _inFlight.size() && _inFlight[delivered].deliverAt <= step)
+		received.push_back(_inFlight[delivered++].input);
+
+	if (delivered)
+		_inFlight.erase(_inFlight.begin(), _inFlight.begin() + delivered);
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef rollback_h
+#define rollback_h
+
+#include <vector>
+#include "MyPhysicsEngine.h"
+#include "Extras/Profiler.h"
+
+/// <summary>
+/// Steps a scene while keeping a ring of snapshots of its most recent steps. Input may be submitted for a step which has
+/// already been simulated, in which case the scene is rolled back to that step and resimulated up to the present with
+/// the input applied at the step it was meant for.
+/// </summary>
+class Rollback
+{
+	private:
+		PhysicsEngine::MyScene* _scene;
+		std::vector<PhysicsEngine::MyScene::Snapshot> _snapshots;	// Indexed by step % window.
+		std::vector<InputEvent> _inputs;							// Input for every step still in the window, in step order.
+		physx::PxU32 _rewind;										// Earliest step which must be resimulated.
+		physx::PxU32 _rollbacks = 0;
+		physx::PxU32 _resimulated = 0;
+		physx::PxU32 _tooLate = 0;
+
+		void Simulate(physx::PxReal dt);
+
+	public:
+		// Time spent saving snapshots, loading them and resimulating after a rollback.
+		ProfileCounter saveTime;
+		ProfileCounter loadTime;
+		ProfileCounter resimulateTime;
+
+		Rollback(PhysicsEngine::MyScene* scene, physx::PxU32 window = 16);
+
+		// Submit an action for the given step, this may be in the past, present or future.
+		void Input(physx::PxU32 step, InputAction action, physx::PxU8 phase = 0);
+
+		// Resimulate any steps invalidated by late input, then take the next step.
+		void Step(physx::PxReal dt);
+
+		// Forget every snapshot and input, needed whenever the scene is reset as the snapshots refer to its actors.
+		void Reset();
+
+		physx::PxU32 Window() const { return (physx::PxU32)_snapshots.size(); }
+		physx::PxU32 Rollbacks() const { return _rollbacks; }
+		physx::PxU32 Resimulated() const { return _resimulated; }
+		physx::PxU32 TooLate() const { return _tooLate; }
+};
+
+/// <summary>
+/// An in-process stand-in for a remote player's connection, delivering input a fixed number of steps after it was sent
+/// with optional jitter. Input is stamped with the step at which it was sent, so on delivery it is already late.
+/// </summary>
+class LoopbackChannel
+{
+	struct Packet
+	{
+		physx::PxU32 deliverAt;
+		InputEvent input;
+	};
+
+	private:
+		std::vector<Packet> _inFlight;
+		physx::PxU32 _latency;
+		physx::PxU32 _jitter;
+		physx::PxU32 _seed;
+
+	public:
+		LoopbackChannel(physx::PxU32 latency, physx::PxU32 jitter = 0, physx::PxU32 seed = 1) : _latency(latency), _jitter(jitter), _seed(seed) { }
+
+		void Send(physx::PxU32 step, InputAction action, physx::PxU8 phase = 0);
+
+		// Move every packet due by the given step into received, in the order they were sent.
+		void Receive(physx::PxU32 step, std::vector<InputEvent>& received);
+
+		// Drop every packet still in flight, e.g. when the scene is reset and their steps no longer mean anything.
+		void Clear() { _inFlight.clear(); }
+
+		physx::PxU32 Latency() const { return _latency; }
+};
+
+#endif
\ No newline at end of file
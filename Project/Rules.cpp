@@ -0,0 +1,192 @@
+#include "Rules.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "Extras/EventQueue.h"
+
+using namespace physx;
+
+const PxU32 ScoringRule::KEEP_MODE;
+const PxU32 ScoringRules::NO_RULE;
+
+// The rules used when no rules file is loaded, these match Assets/rules.txt which documents the format.
+static const char* DEFAULT_RULES =
+	"streak 5 1\n"
+	"rule upper_target contact points 100\n"
+	"rule lower_target contact points 100\n"
+	"rule upper_lane trigger points 200\n"
+	"rule lower_lane trigger points 200\n"
+	"rule drain trigger lives -1\n";
+
+ScoringRules::ScoringRules()
+	: _ids(1), _streakHits(0), _streakMultiplier(0), _hash(14695981039346656037ULL)
+{
+	// Only the base mode and the reserved id 0, so every lookup finds no rule.
+	FindMode("base", true);
+	_table.assign(1, NO_RULE);
+}
+
+void ScoringRules::Defaults()
+{
+	std::istringstream in(DEFAULT_RULES);
+	Parse(in, "default rules");
+}
+
+PxU32 ScoringRules::FindMode(const std::string& name, bool add)
+{
+	for (PxU32 i = 0; i < _modes.size(); i++)
+		if (_modes[i].name == name)
+			return i;
+
+	if (!add)
+		return ScoringRule::KEEP_MODE;
+
+	Mode mode = { name, 0 };
+	_modes.push_back(mode);
+	return (PxU32)_modes.size() - 1;
+}
+
+PxU32 ScoringRules::FindId(const std::string& name, bool add)
+{
+	for (PxU32 i = 1; i < _ids.size(); i++)
+		if (_ids[i] == name)
+			return i;
+
+	if (!add)
+		return 0;
+
+	_ids.push_back(name);
+	return (PxU32)_ids.size() - 1;
+}
+
+PxU32 ScoringRules::Id(const std::string& name) const
+{
+	for (PxU32 i = 1; i < _ids.size(); i++)
+		if (_ids[i] == name)
+			return i;
+	return 0;
+}
+
+bool ScoringRules::Parse(std::istream& in, const std::string& source)
+{
+	// Parse into a fresh set of rules so that the current ones survive an error.
+	ScoringRules parsed;
+
+	// Rule (mode, id) pairs in the order they were read, the table is built from these once every id is known. A rule may
+	// switch to a mode declared further down, so the modes rules switch to are looked up once every mode is known.
+	std::vector<std::pair<PxU32, PxU32> > keys;
+	std::vector<std::string> switches;
+	std::vector<int> lines;
+	PxU32 mode = 0;
+
+	std::string line;
+	for (int number = 1; std::getline(in, line); number++)
+	{
+		std::string text = line.substr(0, line.find('#'));
+		std::istringstream words(text);
+		std::string word;
+		if (!(words >> word))
+			continue;
+
+		// Hash the line's words, so that comments and spacing can change without changing the rules' hash.
+		std::istringstream hashed(text);
+		for (std::string w; hashed >> w; )
+		{
+			for (size_t i = 0; i < w.size(); i++)
+				parsed._hash = (parsed._hash ^ (unsigned char)w[i]) * 1099511628211ULL;
+			parsed._hash = (parsed._hash ^ ' ') * 1099511628211ULL;
+		}
+		parsed._hash = (parsed._hash ^ '\n') * 1099511628211ULL;
+
+		bool valid = true;
+		if (word == "streak")
+			valid = !!(words >> parsed._streakHits >> parsed._streakMultiplier) && parsed._streakHits >= 0;
+		else if (word == "mode")
+		{
+			std::string name;
+			valid = !!(words >> name);
+			mode = parsed.FindMode(name, true);
+
+			while (valid && words >> word)
+				valid = (word == "duration") && (words >> parsed._modes[mode].duration);
+		}
+		else if (word == "rule")
+		{
+			std::string name, event, target;
+			ScoringRule rule = { 0, 0, 0, 0, 0, 0, 0, ScoringRule::KEEP_MODE };
+			valid = !!(words >> name >> event) && (event == "trigger" || event == "contact");
+			rule.event = (event == "trigger") ? GameEvent::TRIGGER_FOUND : GameEvent::CONTACT_FOUND;
+
+			while (valid && words >> word)
+			{
+				if (word == "points")
+					valid = !!(words >> rule.points);
+				else if (word == "multiplier")
+					valid = !!(words >> rule.multiplier);
+				else if (word == "lives")
+					valid = !!(words >> rule.lives);
+				else if (word == "combo")
+					valid = !!(words >> rule.comboCount >> rule.comboSteps >> rule.comboBonus);
+				else if (word == "mode")
+					valid = !!(words >> target);
+				else valid = false;
+			}
+
+			PxU32 id = parsed.FindId(name, true);
+			for (PxU32 i = 0; valid && i < keys.size(); i++)
+				valid = !(keys[i].first == mode && keys[i].second == id);
+
+			keys.push_back(std::make_pair(mode, id));
+			switches.push_back(target);
+			lines.push_back(number);
+			parsed._rules.push_back(rule);
+		}
+		else valid = false;
+
+		if (!valid)
+		{
+			std::cerr << "ScoringRules (source=" << source << ") has an invalid line " << number << ": " << line << std::endl;
+			return false;
+		}
+	}
+
+	// A mode a rule switches to must be declared somewhere, otherwise a misspelt name would quietly make an empty mode.
+	for (PxU32 i = 0; i < switches.size(); i++)
+	{
+		if (switches[i].empty())
+			continue;
+
+		parsed._rules[i].mode = parsed.FindMode(switches[i], false);
+		if (parsed._rules[i].mode == ScoringRule::KEEP_MODE)
+		{
+			std::cerr << "ScoringRules (source=" << source << ") switches to the undeclared mode " << switches[i] << " on line " << lines[i] << "." << std::endl;
+			return false;
+		}
+	}
+
+	// Build the dispatch table, a mode inherits every rule it does not define from the base mode.
+	PxU32 ids = (PxU32)parsed._ids.size();
+	parsed._table.assign(parsed._modes.size() * ids, NO_RULE);
+	for (PxU32 i = 0; i < keys.size(); i++)
+		parsed._table[keys[i].first * ids + keys[i].second] = i;
+
+	for (PxU32 m = 1; m < parsed._modes.size(); m++)
+		for (PxU32 id = 0; id < ids; id++)
+			if (parsed._table[m * ids + id] == NO_RULE)
+				parsed._table[m * ids + id] = parsed._table[id];
+
+	*this = parsed;
+	return true;
+}
+
+bool ScoringRules::Load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		std::cerr << "ScoringRules (path=" << path << ") could not be opened, keeping the current rules." << std::endl;
+		return false;
+	}
+
+	return Parse(file, path);
+}
@@ -0,0 +1,94 @@
+#ifndef rules_h
+#define rules_h
+
+#include <istream>
+#include <string>
+#include <vector>
+#include "PxPhysicsAPI.h"
+
+/// <summary>
+/// What happens when a ball sets off a trigger or hitpoint which carries a scoring rule.
+/// </summary>
+struct ScoringRule
+{
+	static const physx::PxU32 KEEP_MODE = 0xFFFFFFFF;
+
+	physx::PxU32 event;				// GameEvent::Type which sets the rule off, e.g. TRIGGER_FOUND.
+	int points;						// Awarded through the game's multiplier.
+	int multiplier;					// Added to the game's multiplier.
+	int lives;						// Added to the player's lives, a pooled ball is lost instead when this is negative.
+	physx::PxU32 comboCount;		// Hitting the rule this many times within comboSteps awards comboBonus, 0 for none.
+	physx::PxU32 comboSteps;
+	int comboBonus;
+	physx::PxU32 mode;				// Mode to switch to, or KEEP_MODE.
+};
+
+/// <summary>
+/// Scoring rules loaded from data. Triggers and hitpoints carry a rule id in word3 of their simulation filter data and
+/// each mode defines what some of those ids do, anything a mode leaves out behaves as it does in the base mode. Lookups
+/// are a single index into a modes x ids table, so evaluation costs the same however many rules there are.
+/// </summary>
+class ScoringRules
+{
+	public:
+		static const physx::PxU32 NO_RULE = 0xFFFFFFFF;
+
+		struct Mode
+		{
+			std::string name;
+			physx::PxU32 duration;				// Steps before returning to the base mode, 0 to stay until switched.
+		};
+
+		// Per-rule state which changes during play, saved and loaded with the game.
+		struct RuleState
+		{
+			physx::PxU32 comboStart;			// Step at which the current combo window opened.
+			physx::PxU32 comboHits;
+		};
+
+	private:
+		std::vector<std::string> _ids;				// Rule names by id, id 0 is reserved for "no rule".
+		std::vector<Mode> _modes;					// Mode 0 is the base mode.
+		std::vector<ScoringRule> _rules;
+		std::vector<physx::PxU32> _table;			// Rule index for [mode * ids + id], or NO_RULE.
+		int _streakHits;
+		int _streakMultiplier;
+		physx::PxU64 _hash;							// FNV-1a of the rules' words, see Hash.
+
+		physx::PxU32 FindMode(const std::string& name, bool add);
+		physx::PxU32 FindId(const std::string& name, bool add);
+
+	public:
+		// An empty set of rules, under which nothing scores.
+		ScoringRules();
+
+		// Replace the rules with the built-in ones, which match Assets/rules.txt.
+		void Defaults();
+
+		// Replace the rules with those read from the stream or file, on an error the current rules are kept.
+		bool Parse(std::istream& in, const std::string& source);
+		bool Load(const std::string& path);
+
+		// Hash of the text the rules were parsed from, ignoring comments and spacing. A recording stores this, as a game only
+		// replays under the rules it was played with.
+		physx::PxU64 Hash() const { return _hash; }
+
+		// Rule id for a name used in the rules, or 0 if no rule uses it.
+		physx::PxU32 Id(const std::string& name) const;
+
+		// Index of the rule for an id in a mode, or NO_RULE.
+		physx::PxU32 Lookup(physx::PxU32 mode, physx::PxU32 id) const
+		{
+			return (mode < _modes.size() && id < _ids.size()) ? _table[mode * _ids.size() + id] : NO_RULE;
+		}
+
+		const ScoringRule& Get(physx::PxU32 index) const { return _rules[index]; }
+		const Mode& GetMode(physx::PxU32 mode) const { return _modes[mode]; }
+		physx::PxU32 Count() const { return (physx::PxU32)_rules.size(); }
+
+		// Every streakHits-th scoring hit adds streakMultiplier to the game's multiplier.
+		int StreakHits() const { return _streakHits; }
+		int StreakMultiplier() const { return _streakMultiplier; }
+};
+
+#endif
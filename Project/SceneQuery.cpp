@@ -0,0 +1,217 @@
+#include "SceneQuery.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+	using namespace std;
+
+	//query filter word1 flags, set when ungrouped scenery should be reported and for overlaps, which cannot block
+	static const PxU32 QUERY_SCENERY = (1 << 0);
+	static const PxU32 QUERY_OVERLAP = (1 << 1);
+
+	static PxQueryHitType::Enum GroupPreFilter(PxFilterData query_data, PxFilterData object_data, const void* constant_block, PxU32 constant_block_size, PxHitFlags& hit_flags)
+	{
+		//scenery always blocks so that walls occlude anything behind them, grouped shapes are touches when the batch
+		//has room for touches and blocks otherwise. Overlaps do not support blocking hits, so they only ever touch
+		PxU32 touches = *(const PxU32*)constant_block;
+		PxQueryHitType::Enum hit = PxQueryHitType::eNONE;
+
+		if (!object_data.word0)
+			hit = (query_data.word1 & QUERY_SCENERY) ? PxQueryHitType::eBLOCK : PxQueryHitType::eNONE;
+		else if (query_data.word0 & object_data.word0)
+			hit = touches ? PxQueryHitType::eTOUCH : PxQueryHitType::eBLOCK;
+
+		if (hit == PxQueryHitType::eBLOCK && (query_data.word1 & QUERY_OVERLAP))
+			hit = PxQueryHitType::eTOUCH;
+
+		return hit;
+	}
+
+	BatchQuery::BatchQuery(Scene* _scene, PxU32 max_raycasts, PxU32 max_sweeps, PxU32 max_overlaps, PxU32 max_touches_per_query, PxU32 threads)
+		: scene(_scene), max_touches(max_touches_per_query)
+	{
+		raycasts.reserve(max_raycasts);
+		sweeps.reserve(max_sweeps);
+		overlaps.reserve(max_overlaps);
+
+		raycast_results.resize(max_raycasts);
+		sweep_results.resize(max_sweeps);
+		overlap_results.resize(max_overlaps);
+		raycast_touches.resize(max_raycasts * max_touches);
+		sweep_touches.resize(max_sweeps * max_touches);
+		overlap_touches.resize(max_overlaps * max_touches);
+
+		//each worker owns a PxBatchQuery, the result buffers are shared and handed out in slices on every Execute
+		PxBatchQueryDesc desc(max_raycasts, max_sweeps, max_overlaps);
+		desc.queryMemory.userRaycastResultBuffer = raycast_results.data();
+		desc.queryMemory.userRaycastTouchBuffer = raycast_touches.data();
+		desc.queryMemory.raycastTouchBufferSize = (PxU32)raycast_touches.size();
+		desc.queryMemory.userSweepResultBuffer = sweep_results.data();
+		desc.queryMemory.userSweepTouchBuffer = sweep_touches.data();
+		desc.queryMemory.sweepTouchBufferSize = (PxU32)sweep_touches.size();
+		desc.queryMemory.userOverlapResultBuffer = overlap_results.data();
+		desc.queryMemory.userOverlapTouchBuffer = overlap_touches.data();
+		desc.queryMemory.overlapTouchBufferSize = (PxU32)overlap_touches.size();
+		desc.preFilterShader = GroupPreFilter;
+		desc.filterShaderData = &max_touches;
+		desc.filterShaderDataSize = sizeof(PxU32);
+
+		for (PxU32 i = 0; i < PxMax(threads, 1u); i++)
+		{
+			PxBatchQuery* batch = scene->Get()->createBatchQuery(desc);
+			if (!batch)
+				throw new Exception("PhysicsEngine::BatchQuery, Could not create the batch query.");
+			batches.push_back(batch);
+		}
+
+		//the calling thread runs the first batch itself
+		for (PxU32 i = 1; i < batches.size(); i++)
+			worker_threads.push_back(std::thread(&BatchQuery::Worker, this, i));
+	}
+
+	BatchQuery* Scene::CreateBatchQuery(PxU32 max_raycasts, PxU32 max_sweeps, PxU32 max_overlaps, PxU32 max_touches_per_query, PxU32 threads)
+	{
+		return new BatchQuery(this, max_raycasts, max_sweeps, max_overlaps, max_touches_per_query, threads);
+	}
+
+	BatchQuery::~BatchQuery()
+	{
+		{
+			std::lock_guard<std::mutex> lock(worker_mutex);
+			stopping = true;
+		}
+		worker_wake.notify_all();
+		for (unsigned int i = 0; i < worker_threads.size(); i++)
+			worker_threads[i].join();
+
+		for (unsigned int i = 0; i < batches.size(); i++)
+			batches[i]->release();
+	}
+
+	PxQueryFilterData BatchQuery::Filter(PxU32 groups, bool scenery)
+	{
+		return PxQueryFilterData(PxFilterData(groups, scenery ? QUERY_SCENERY : 0, 0, 0),
+			PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::ePREFILTER);
+	}
+
+	bool BatchQuery::Raycast(const PxVec3& origin, const PxVec3& dir, PxReal distance, PxU32 groups, bool scenery, void* user_data)
+	{
+		if (raycasts.size() == raycasts.capacity())
+			return false;
+
+		RaycastQuery query = { origin, dir, distance, Filter(groups, scenery), user_data };
+		raycasts.push_back(query);
+		return true;
+	}
+
+	bool BatchQuery::Sweep(const PxGeometry& geometry, const PxTransform& pose, const PxVec3& dir, PxReal distance, PxU32 groups, bool scenery, void* user_data)
+	{
+		if (sweeps.size() == sweeps.capacity())
+			return false;
+
+		SweepQuery query = { PxGeometryHolder(geometry), pose, dir, distance, Filter(groups, scenery), user_data };
+		sweeps.push_back(query);
+		return true;
+	}
+
+	bool BatchQuery::Overlap(const PxGeometry& geometry, const PxTransform& pose, PxU32 groups, bool scenery, void* user_data)
+	{
+		if (overlaps.size() == overlaps.capacity())
+			return false;
+
+		OverlapQuery query = { PxGeometryHolder(geometry), pose, Filter(groups, scenery), user_data };
+		query.filter.data.word1 |= QUERY_OVERLAP;
+		overlaps.push_back(query);
+		return true;
+	}
+
+	void BatchQuery::ExecuteRange(PxU32 batch, PxU32 worker, PxU32 workers)
+	{
+		//split each query type evenly between the workers, this worker handles [begin, end) of each
+		PxU32 r0 = (PxU32)raycasts.size() * worker / workers, r1 = (PxU32)raycasts.size() * (worker+1) / workers;
+		PxU32 s0 = (PxU32)sweeps.size() * worker / workers, s1 = (PxU32)sweeps.size() * (worker+1) / workers;
+		PxU32 o0 = (PxU32)overlaps.size() * worker / workers, o1 = (PxU32)overlaps.size() * (worker+1) / workers;
+
+		if (r0 == r1 && s0 == s1 && o0 == o1)
+			return;
+
+		PxBatchQueryMemory memory(r1-r0, s1-s0, o1-o0);
+		memory.userRaycastResultBuffer = raycast_results.data() + r0;
+		memory.userRaycastTouchBuffer = raycast_touches.data() + r0*max_touches;
+		memory.raycastTouchBufferSize = (r1-r0)*max_touches;
+		memory.userSweepResultBuffer = sweep_results.data() + s0;
+		memory.userSweepTouchBuffer = sweep_touches.data() + s0*max_touches;
+		memory.sweepTouchBufferSize = (s1-s0)*max_touches;
+		memory.userOverlapResultBuffer = overlap_results.data() + o0;
+		memory.userOverlapTouchBuffer = overlap_touches.data() + o0*max_touches;
+		memory.overlapTouchBufferSize = (o1-o0)*max_touches;
+
+		PxBatchQuery* query = batches[batch];
+		query->setUserMemory(memory);
+
+		for (PxU32 i = r0; i < r1; i++)
+			query->raycast(raycasts[i].origin, raycasts[i].dir, raycasts[i].distance, (PxU16)max_touches, PxHitFlag::eDEFAULT, raycasts[i].filter, raycasts[i].user_data);
+
+		for (PxU32 i = s0; i < s1; i++)
+			query->sweep(sweeps[i].geometry.any(), sweeps[i].pose, sweeps[i].dir, sweeps[i].distance, (PxU16)max_touches, PxHitFlag::eDEFAULT, sweeps[i].filter, sweeps[i].user_data);
+
+		for (PxU32 i = o0; i < o1; i++)
+			query->overlap(overlaps[i].geometry.any(), overlaps[i].pose, (PxU16)max_touches, overlaps[i].filter, overlaps[i].user_data);
+
+		query->execute();
+	}
+
+	void BatchQuery::Execute()
+	{
+		//the scene must not be simulating while queries run, Scene::Update always fetches results before returning
+		PxU32 workers = (PxU32)batches.size();
+
+		//small batches are not worth the cost of waking threads
+		PxU32 total = (PxU32)(raycasts.size() + sweeps.size() + overlaps.size());
+		if (workers == 1 || total < 64*workers)
+		{
+			ExecuteRange(0, 0, 1);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(worker_mutex);
+			pending = workers - 1;
+			generation++;
+		}
+		worker_wake.notify_all();
+
+		ExecuteRange(0, 0, workers);
+
+		std::unique_lock<std::mutex> lock(worker_mutex);
+		worker_done.wait(lock, [this] { return pending == 0; });
+	}
+
+	void BatchQuery::Worker(PxU32 index)
+	{
+		PxU32 seen = 0;
+		std::unique_lock<std::mutex> lock(worker_mutex);
+		while (true)
+		{
+			worker_wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+
+			//the queries are not touched by Execute's caller until every worker has finished
+			lock.unlock();
+			ExecuteRange(index, index, (PxU32)batches.size());
+			lock.lock();
+
+			if (--pending == 0)
+				worker_done.notify_one();
+		}
+	}
+
+	void BatchQuery::Clear()
+	{
+		raycasts.clear();
+		sweeps.clear();
+		overlaps.clear();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "PhysicsEngine.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Batched raycasts, sweeps and overlaps against a Scene.
+	///Queries are queued with Raycast/Sweep/Overlap and resolved together by Execute, all memory and worker threads are
+	///created up front so queuing and executing never allocates. Results stay valid until the next Clear or Execute.
+	///Filtering uses the FilterGroup bits: a query only reports shapes whose group is in its group mask, and shapes
+	///without a group (walls, the platform) are reported only when scenery is requested.
+	class BatchQuery
+	{
+	protected:
+		struct SweepQuery
+		{
+			PxGeometryHolder geometry;
+			PxTransform pose;
+			PxVec3 dir;
+			PxReal distance;
+			PxQueryFilterData filter;
+			void* user_data;
+		};
+
+		struct OverlapQuery
+		{
+			PxGeometryHolder geometry;
+			PxTransform pose;
+			PxQueryFilterData filter;
+			void* user_data;
+		};
+
+		struct RaycastQuery
+		{
+			PxVec3 origin;
+			PxVec3 dir;
+			PxReal distance;
+			PxQueryFilterData filter;
+			void* user_data;
+		};
+
+		Scene* scene;
+		PxU32 max_touches;
+		std::vector<PxBatchQuery*> batches;			//one per worker thread
+
+		//workers other than the calling thread wait for each Execute, which bumps the generation and waits for them all
+		std::vector<std::thread> worker_threads;
+		std::mutex worker_mutex;
+		std::condition_variable worker_wake;
+		std::condition_variable worker_done;
+		PxU32 generation = 0;
+		PxU32 pending = 0;
+		bool stopping = false;
+
+		std::vector<RaycastQuery> raycasts;
+		std::vector<SweepQuery> sweeps;
+		std::vector<OverlapQuery> overlaps;
+
+		std::vector<PxRaycastQueryResult> raycast_results;
+		std::vector<PxSweepQueryResult> sweep_results;
+		std::vector<PxOverlapQueryResult> overlap_results;
+		std::vector<PxRaycastHit> raycast_touches;
+		std::vector<PxSweepHit> sweep_touches;
+		std::vector<PxOverlapHit> overlap_touches;
+
+		void ExecuteRange(PxU32 batch, PxU32 worker, PxU32 workers);
+
+		void Worker(PxU32 index);
+
+	public:
+		BatchQuery(Scene* scene, PxU32 max_raycasts, PxU32 max_sweeps=0, PxU32 max_overlaps=0, PxU32 max_touches_per_query=0, PxU32 threads=1);
+
+		~BatchQuery();
+
+		static PxQueryFilterData Filter(PxU32 groups, bool scenery=true);
+
+		bool Raycast(const PxVec3& origin, const PxVec3& dir, PxReal distance, PxU32 groups, bool scenery=true, void* user_data=0);
+
+		bool Sweep(const PxGeometry& geometry, const PxTransform& pose, const PxVec3& dir, PxReal distance, PxU32 groups, bool scenery=true, void* user_data=0);
+
+		bool Overlap(const PxGeometry& geometry, const PxTransform& pose, PxU32 groups, bool scenery=true, void* user_data=0);
+
+		void Execute();
+
+		void Clear();
+
+		PxU32 NbRaycasts() { return (PxU32)raycasts.size(); }
+		PxU32 NbSweeps() { return (PxU32)sweeps.size(); }
+		PxU32 NbOverlaps() { return (PxU32)overlaps.size(); }
+
+		const PxRaycastQueryResult& RaycastResult(PxU32 index) { return raycast_results[index]; }
+		const PxSweepQueryResult& SweepResult(PxU32 index) { return sweep_results[index]; }
+		const PxOverlapQueryResult& OverlapResult(PxU32 index) { return overlap_results[index]; }
+	};
+}
\ No newline at end of file
@@ -0,0 +1,306 @@
+#include "Telemetry.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include "Extras/Profiler.h"
+
+namespace Telemetry
+{
+	using namespace std;
+
+	static const char TELEMETRY_MAGIC[4] = { 'P', 'B', 'T', 'M' };
+	static const PxU32 TELEMETRY_VERSION = 1;
+
+	static_assert(sizeof(Record) == 28, "Telemetry::Record must stay a fixed 28 bytes, update TELEMETRY_VERSION if it changes.");
+
+	static PxI16 Quantize(PxReal value, PxReal scale)
+	{
+		PxReal q = value / scale;
+		return (PxI16)PxClamp(q < 0.f ? q - .5f : q + .5f, -32767.f, 32767.f);
+	}
+
+	Writer::Writer(const string& path, const PxBounds3& bounds, PxU32 slots, PxU32 blockRecords, PxU32 blocks)
+		: _current(0), _count(0), _lostContacts(true), _written(0), _dropped(0), _closing(false)
+	{
+		memcpy(_header.magic, TELEMETRY_MAGIC, 4);
+		_header.version = TELEMETRY_VERSION;
+		_header.recordSize = sizeof(Record);
+		_header.origin = bounds.isEmpty() ? PxVec3(0.f) : bounds.getCenter();
+		_header.positionScale = (bounds.isEmpty() ? 32.f : PxMax(bounds.getExtents().maxElement(), 1.f)) / 32767.f;
+		_header.velocityScale = 100.f / 32767.f;
+		_header.angularScale = 500.f / 32767.f;
+
+		_file = fopen(path.c_str(), "wb");
+		if (!_file)
+		{
+			cerr << "Telemetry (path=" << path << ") could not be opened for writing." << endl;
+			return;
+		}
+		fwrite(&_header, sizeof(Header), 1, _file);
+
+		// All memory is allocated here, writing a record never allocates.
+		_blocks.resize(PxMax(blocks, 2u));
+		for (PxU32 i = 0; i < _blocks.size(); i++)
+		{
+			_blocks[i].resize(PxMax(blockRecords, 1u));
+			if (i != _current)
+				_free.push_back(i);
+		}
+		_full.reserve(_blocks.size());
+
+		_contacts.resize(PxMin(slots, 65536u), 0);
+		_zones.resize(_contacts.size(), 0);
+
+		_thread = std::thread(&Writer::Flush, this);
+	}
+
+	Writer::~Writer()
+	{
+		Close();
+	}
+
+	void Writer::Event(const GameEvent& e)
+	{
+		// Slot 0 is the player and pooled balls store (slot + 1) in word2, so word2 is the telemetry slot.
+		PxU32 slot = e.filters[0].word2;
+		if (slot >= _contacts.size())
+			return;
+
+		switch (e.type)
+		{
+			case GameEvent::CONTACT_FOUND:
+				if (_contacts[slot] < 255)
+					_contacts[slot]++;
+				break;
+			case GameEvent::CONTACT_LOST:
+				if (_contacts[slot] > 0)
+					_contacts[slot]--;
+				break;
+			case GameEvent::TRIGGER_FOUND: _zones[slot] |= (PxU16)e.filters[1].word0;
+				break;
+			default:
+				break;
+		}
+	}
+
+	void Writer::Write(PxU32 step, PxU32 slot, PxRigidDynamic* body)
+	{
+		if (!_file || slot >= _contacts.size())
+			return;
+
+		PxVec3 p = body->getGlobalPose().p - _header.origin;
+		PxVec3 v = body->getLinearVelocity();
+		PxVec3 w = body->getAngularVelocity();
+
+		Record& r = _blocks[_current][_count];
+		r.step = step;
+		r.slot = (PxU16)slot;
+		r.contacts = _contacts[slot];
+		r.zones = _zones[slot];
+		for (int i = 0; i < 3; i++)
+		{
+			r.position[i] = Quantize(p[i], _header.positionScale);
+			r.velocity[i] = Quantize(v[i], _header.velocityScale);
+			r.angular[i] = Quantize(w[i], _header.angularScale);
+		}
+		r.flags = (body->isSleeping() ? Record::SLEEPING : 0) | (_lostContacts ? 0 : Record::NEW_CONTACTS);
+
+		// Zones are only reported for the step in which they were entered, as are contacts when they are never lost.
+		_zones[slot] = 0;
+		if (!_lostContacts)
+			_contacts[slot] = 0;
+
+		if (++_count == _blocks[_current].size())
+			Submit();
+	}
+
+	void Writer::Submit()
+	{
+		// Hand the current block to the flush thread and continue in a free one. If every block is still waiting to be
+		// written, the current block is discarded and reused instead.
+		{
+			lock_guard<mutex> lock(_mutex);
+			if (_free.empty())
+			{
+				_dropped += _count;
+				_count = 0;
+				return;
+			}
+
+			_full.push_back(_current);
+			_written += _count;
+			_current = _free.back();
+			_free.pop_back();
+		}
+
+		_count = 0;
+		_ready.notify_one();
+	}
+
+	void Writer::Flush()
+	{
+		// Background thread, writes full blocks in order until the writer is closed and every block has been written.
+		unique_lock<mutex> lock(_mutex);
+		while (true)
+		{
+			_ready.wait(lock, [this] { return _closing || !_full.empty(); });
+			if (_full.empty())
+				break;
+
+			PxU32 block = _full.front();
+			_full.erase(_full.begin());
+			PxU32 count = (PxU32)_blocks[block].size();
+
+			// The final block may only be partly filled, it is marked by being submitted while closing.
+			if (_closing && _full.empty() && block == _current)
+				count = _count;
+
+			lock.unlock();
+			fwrite(&_blocks[block][0], sizeof(Record), count, _file);
+			lock.lock();
+
+			_free.push_back(block);
+		}
+	}
+
+	void Writer::Close()
+	{
+		if (!_file)
+			return;
+
+		// Queue the partly filled block and let the flush thread drain everything before closing the file.
+		{
+			lock_guard<mutex> lock(_mutex);
+			if (_count)
+			{
+				_full.push_back(_current);
+				_written += _count;
+			}
+			_closing = true;
+		}
+		_ready.notify_one();
+		_thread.join();
+
+		fclose(_file);
+		_file = nullptr;
+	}
+
+	Reader::Reader(const string& path)
+	{
+		_file = fopen(path.c_str(), "rb");
+		if (!_file)
+		{
+			cerr << "Telemetry (path=" << path << ") could not be opened." << endl;
+			return;
+		}
+
+		if (fread(&_header, sizeof(Header), 1, _file) != 1 || memcmp(_header.magic, TELEMETRY_MAGIC, 4) != 0 ||
+			_header.version != TELEMETRY_VERSION || _header.recordSize != sizeof(Record))
+		{
+			cerr << "Telemetry (path=" << path << ") is not a valid telemetry file." << endl;
+			fclose(_file);
+			_file = nullptr;
+			return;
+		}
+
+		// Records are consumed sequentially in large chunks, so give the stream a matching buffer.
+		setvbuf(_file, nullptr, _IOFBF, 1 << 20);
+	}
+
+	Reader::~Reader()
+	{
+		if (_file)
+			fclose(_file);
+	}
+
+	PxU32 Reader::Read(Record* records, PxU32 max)
+	{
+		return _file ? (PxU32)fread(records, sizeof(Record), max, _file) : 0;
+	}
+
+	PxVec3 Reader::Position(const Record& r) const
+	{
+		return _header.origin + PxVec3(r.position[0], r.position[1], r.position[2]) * _header.positionScale;
+	}
+
+	PxVec3 Reader::Velocity(const Record& r) const
+	{
+		return PxVec3(r.velocity[0], r.velocity[1], r.velocity[2]) * _header.velocityScale;
+	}
+
+	PxVec3 Reader::Angular(const Record& r) const
+	{
+		return PxVec3(r.angular[0], r.angular[1], r.angular[2]) * _header.angularScale;
+	}
+
+	bool Scan(const string& path, int slot, bool csv)
+	{
+		Reader reader(path);
+		if (!reader.IsOpen())
+			return false;
+
+		const PxU32 chunk = 1 << 16;
+		vector<Record> records(chunk);
+
+		PxU64 total = 0, matched = 0, sleeping = 0;
+		PxU32 firstStep = 0xFFFFFFFF, lastStep = 0, maxContacts = 0, zoneEntries[16] = {};
+		PxReal maxSpeed2 = 0.f;
+
+		if (csv)
+			cout << "step,slot,px,py,pz,vx,vy,vz,wx,wy,wz,contacts,zones,sleeping" << endl;
+
+		// Velocities are compared in quantized units squared, so the scan loop does no floating point conversion.
+		Stopwatch timer;
+		PxU32 count;
+		while ((count = reader.Read(&records[0], chunk)) > 0)
+		{
+			total += count;
+			for (PxU32 i = 0; i < count; i++)
+			{
+				const Record& r = records[i];
+				if (slot >= 0 && r.slot != slot)
+					continue;
+
+				matched++;
+				firstStep = PxMin(firstStep, r.step);
+				lastStep = PxMax(lastStep, r.step);
+				maxContacts = PxMax(maxContacts, (PxU32)r.contacts);
+				if (r.flags & Record::SLEEPING)
+					sleeping++;
+
+				PxReal speed2 = (PxReal)r.velocity[0] * r.velocity[0] + (PxReal)r.velocity[1] * r.velocity[1] + (PxReal)r.velocity[2] * r.velocity[2];
+				maxSpeed2 = PxMax(maxSpeed2, speed2);
+
+				for (PxU32 zones = r.zones, b = 0; zones; zones >>= 1, b++)
+					if (zones & 1)
+						zoneEntries[b]++;
+
+				if (csv)
+				{
+					PxVec3 p = reader.Position(r), v = reader.Velocity(r), w = reader.Angular(r);
+					cout << r.step << "," << r.slot << "," << p.x << "," << p.y << "," << p.z << "," << v.x << "," << v.y << "," << v.z << ","
+						<< w.x << "," << w.y << "," << w.z << "," << (PxU32)r.contacts << "," << r.zones << "," << (r.flags & Record::SLEEPING) << "\n";
+				}
+			}
+		}
+		double seconds = timer.Elapsed() / 1000.0;
+
+		if (csv)
+			return true;
+
+		double megabytes = total * sizeof(Record) / (1024.0 * 1024.0);
+		cout << path << ": " << total << " records (" << fixed << setprecision(1) << megabytes << " MB) scanned in " << setprecision(3) << seconds
+			<< "s, " << setprecision(0) << (seconds > 0.0 ? megabytes / seconds : 0.0) << " MB/s" << endl;
+
+		cout << setprecision(3);
+		cout << "  matched: " << matched << ", steps: " << (matched ? firstStep : 0) << "-" << lastStep << ", sleeping: " << sleeping << endl;
+		cout << "  max speed: " << PxSqrt(maxSpeed2) * reader.header().velocityScale << " m/s, max contacts: " << maxContacts << endl;
+		cout << "  zone entries (by FilterGroup bit):";
+		for (PxU32 b = 0; b < 16; b++)
+			if (zoneEntries[b])
+				cout << " " << (1u << b) << "=" << zoneEntries[b];
+		cout << endl;
+
+		return true;
+	}
+}
\ No newline at end of file
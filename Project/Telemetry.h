@@ -0,0 +1,126 @@
+#ifndef telemetry_h
+#define telemetry_h
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include "PxPhysicsAPI.h"
+#include "Extras/EventQueue.h"
+
+namespace Telemetry
+{
+	using namespace physx;
+
+	struct Header
+	{
+		char magic[4];
+		PxU32 version;
+		PxU32 recordSize;
+		PxVec3 origin;					// Positions are stored relative to the centre of the world bounds...
+		PxReal positionScale;			// ... in units of this many metres.
+		PxReal velocityScale;			// Metres per second per unit.
+		PxReal angularScale;			// Radians per second per unit.
+	};
+
+	/// <summary>
+	/// The state of a single ball after a single step. Every record is the same size so that a file can be scanned, or
+	/// seeked into, without parsing. Slot 0 is the player's ball and slot n is multiball pool slot n - 1.
+	/// </summary>
+	struct Record
+	{
+		PxU32 step;
+		PxU16 slot;
+		PxU8 contacts;					// Reported contacts the ball is currently touching, see NEW_CONTACTS.
+		PxU8 flags;
+		PxU16 zones;					// FilterGroup bits of every trigger zone the ball entered during this step.
+		PxI16 position[3];
+		PxI16 velocity[3];
+		PxI16 angular[3];
+
+		enum Flags : PxU8
+		{
+			SLEEPING = (1 << 0),
+			NEW_CONTACTS = (1 << 1)		// Lost contacts were not reported, so contacts counts those found during this step.
+		};
+	};
+
+	/// <summary>
+	/// Streams records to a file. Records are appended to preallocated blocks on the simulation thread and full blocks are
+	/// written out by a background thread, so the only cost during a step is quantizing and copying each record. If the
+	/// disk falls behind and no block is free, the oldest unsaved records are dropped rather than stalling the step.
+	/// </summary>
+	class Writer
+	{
+		private:
+			FILE* _file;
+			Header _header;
+			std::vector<std::vector<Record>> _blocks;
+			std::vector<PxU32> _free;			// Blocks ready to be filled.
+			std::vector<PxU32> _full;			// Blocks waiting to be written, in order.
+			PxU32 _current;
+			PxU32 _count;						// Records in the current block.
+			std::vector<PxU8> _contacts;		// Per-slot state accumulated from game events.
+			std::vector<PxU16> _zones;
+			bool _lostContacts;					// Whether CONTACT_LOST events arrive, see LostContacts.
+			PxU64 _written;
+			PxU64 _dropped;
+			bool _closing;
+
+			std::thread _thread;
+			std::mutex _mutex;
+			std::condition_variable _ready;
+
+			void Submit();
+			void Flush();
+
+		public:
+			Writer(const std::string& path, const PxBounds3& bounds, PxU32 slots, PxU32 blockRecords = 8192, PxU32 blocks = 8);
+			~Writer();
+
+			bool IsOpen() const { return _file != nullptr; }
+
+			void Event(const GameEvent& e);
+
+			// Whether lost contacts are reported, e.g. not with ContactReporting::MINIMAL. Without them the contacts being
+			// touched cannot be tracked, so each record instead counts the contacts found during its step.
+			void LostContacts(bool reported) { _lostContacts = reported; }
+			void Write(PxU32 step, PxU32 slot, PxRigidDynamic* body);
+			void Close();
+
+			PxU64 Records() const { return _written; }
+			PxU64 Dropped() const { return _dropped; }
+	};
+
+	/// <summary>
+	/// Reads records back in large sequential chunks.
+	/// </summary>
+	class Reader
+	{
+		private:
+			FILE* _file;
+			Header _header;
+
+		public:
+			Reader(const std::string& path);
+			~Reader();
+
+			bool IsOpen() const { return _file != nullptr; }
+			const Header& header() const { return _header; }
+
+			// Read up to max records into records, returning the number read (zero at the end of the file).
+			PxU32 Read(Record* records, PxU32 max);
+
+			PxVec3 Position(const Record& r) const;
+			PxVec3 Velocity(const Record& r) const;
+			PxVec3 Angular(const Record& r) const;
+	};
+
+	// Summarise a telemetry file, optionally only for a single slot or dumping every record as CSV. Returns false if the
+	// file could not be read.
+	bool Scan(const std::string& path, int slot = -1, bool csv = false);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "Tests.h"
+#include <iostream>
+
+// Only the tests read the rules at run time, so the array is defined here rather than in MyPhysicsEngine.h.
+constexpr FilterRule PhysicsEngine::TableRules::rules[];
+
+namespace Tests
+{
+	using namespace PhysicsEngine;
+
+	// The flags TableRules gives a pair of groups, looked up directly rather than through the generated table.
+	static PxU8 RuleFlags(PxU32 group0, PxU32 group1)
+	{
+		for (PxU32 i = 0; i < TableRules::count; i++)
+		{
+			const FilterRule& rule = TableRules::rules[i];
+			if ((rule.group0 == group0 && rule.group1 == group1) || (rule.group0 == group1 && rule.group1 == group0))
+				return rule.flags;
+		}
+		return TableRules::fallback;
+	}
+
+	// The pair flags a rule should produce, written plainly.
+	static PxU32 ExpectedPairFlags(PxU8 rule, bool trigger, PxU32 notify)
+	{
+		if (trigger)
+			return (rule & FilterFlag::TRIGGER) ? (PxU32)PxPairFlag::eTRIGGER_DEFAULT : 0u;
+
+		PxU32 flags = 0;
+		if (rule & FilterFlag::SOLVE)
+			flags |= PxPairFlag::eSOLVE_CONTACT | PxPairFlag::eDETECT_DISCRETE_CONTACT;
+		if (rule & FilterFlag::CCD)
+			flags |= PxPairFlag::eDETECT_CCD_CONTACT;
+		if (rule & FilterFlag::NOTIFY)
+			flags |= notify;
+		return flags;
+	}
+
+	PxU32 FilterShader()
+	{
+		// Shapes are tried as rigid statics, either plain or as triggers. Group words also carry bits above the table, which
+		// the shader must ignore, and are paired with each of the other filter data words a shape may use.
+		const PxFilterObjectAttributes shape = PxFilterObjectType::eRIGID_STATIC;
+		const PxFilterObjectAttributes trigger = PxFilterObjectType::eRIGID_STATIC | PxFilterObjectFlag::eTRIGGER;
+		const PxU32 high = TableFilter::SIZE | 0x80000000u;
+
+		// No constant block, a block with its own notify flags, and one too small to hold them.
+		FilterShaderBlock block = { PxPairFlag::eNOTIFY_TOUCH_FOUND | PxPairFlag::eNOTIFY_CONTACT_POINTS };
+		struct { const void* data; PxU32 size; PxU32 notify; } blocks[] = {
+			{ nullptr, 0, TableFilter::DefaultNotify },
+			{ &block, sizeof(block), block.notifyFlags },
+			{ &block, sizeof(block) - 1, TableFilter::DefaultNotify }
+		};
+
+		PxU32 failed = 0, cases = 0;
+		for (PxU32 g0 = 0; g0 < TableFilter::SIZE; g0++)
+		for (PxU32 g1 = 0; g1 < TableFilter::SIZE; g1++)
+		for (PxU32 t = 0; t < 4; t++)
+		for (PxU32 b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++)
+		for (PxU32 h = 0; h < 2; h++)
+		{
+			bool trigger0 = (t & 1) != 0, trigger1 = (t & 2) != 0;
+			PxFilterData data0(g0 | (h ? high : 0), 0, h ? 3 : 0, 0);
+			PxFilterData data1(g1 | (h ? high : 0), 0, 0, h ? 7 : 0);
+
+			PxPairFlags pairFlags;
+			PxFilterFlags filterFlags = TableFilter::Shader(trigger0 ? trigger : shape, data0, trigger1 ? trigger : shape, data1,
+				pairFlags, blocks[b].data, blocks[b].size);
+
+			PxU32 expected = ExpectedPairFlags(RuleFlags(g0, g1), trigger0 || trigger1, blocks[b].notify);
+			bool killed = filterFlags.isSet(PxFilterFlag::eKILL);
+			cases++;
+
+			if ((PxU32)pairFlags != expected || killed != (expected == 0))
+			{
+				std::cerr << "FilterShader: groups " << g0 << " and " << g1 << (trigger0 ? " (trigger)" : "") << (trigger1 ? " (trigger)" : "")
+					<< ", block " << b << (h ? ", high bits" : "") << ": pair flags " << (PxU32)pairFlags << " expected " << expected
+					<< (killed ? ", killed" : ", not killed") << std::endl;
+				failed++;
+			}
+		}
+
+		std::cout << "FilterShader: " << cases - failed << "/" << cases << " cases passed." << std::endl;
+		return failed;
+	}
+
+	PxU32 Run()
+	{
+		return FilterShader();
+	}
+}
@@ -0,0 +1,18 @@
+#ifndef tests_h
+#define tests_h
+
+#include "MyPhysicsEngine.h"
+
+namespace Tests
+{
+	using namespace physx;
+
+	// Call the table filter shader for every pair of groups, with and without triggers and a constant block, and compare
+	// what it returns against TableRules. Returns the number of cases which failed.
+	PxU32 FilterShader();
+
+	// Run every test, reporting each failure, and return the number of failures.
+	PxU32 Run();
+}
+
+#endif
@@ -7,17 +7,30 @@ namespace VisualDebugger
 	PxReal delta_time = 1.f / 60.f;
 	PxReal gForceStrength = 10;
 	RenderMode render_mode = NORMAL;
-	const int MAX_KEYS = 256;
-	bool key_state[MAX_KEYS];
+	InputMap input_map;
+	PxU64 last_step_time = 0;				// When input was last delivered to the scene, in microseconds.
 	bool hud_show = true;
 	HUD hud;
 	int activeScreen = SCORE;
+	Recording* recording = nullptr;
+	std::string recording_path;
+	PxU32 recording_games = 0;				// Games recorded so far, each game after the first gets its own numbered file.
+	Telemetry::Writer* telemetry = nullptr;
+	Rollback* rollback = nullptr;
+	LoopbackChannel* loopback = nullptr;
+	Autopilot* autopilot = nullptr;
+	InputLatency* latency = nullptr;
+	bool low_latency = false;
+	PxU64 stepped_time = 0;					// When the scene last finished a step, in microseconds.
+	double swap_time = 0.0;					// How long the last Renderer::Finish took, in milliseconds.
+	std::vector<InputEvent> received;
 
 
 	void Init(const char *window_name, int width, int height)
 	{
 		PhysicsEngine::PxInit();
 		scene = new PhysicsEngine::MyScene();
+		scene->Config(Replay::SceneConfig());
 		scene->Init();
 
 		Renderer::BackgroundColor(PxVec3(150.f/255.f,150.f/255.f,150.f/255.f));
@@ -27,6 +40,7 @@ namespace VisualDebugger
 
 		camera = new Camera(PxVec3(0.0f, 11.5f, 11.5f), PxVec3(0.f,-2.f,-4.f), 5.f);
 
+		BindKeys();
 		HUDInit();
 
 		glutDisplayFunc(RenderScene);
@@ -40,6 +54,29 @@ namespace VisualDebugger
 		motionCallback(0,0);
 	}
 
+	void BindKeys()
+	{
+		input_map.Bind(',', CONTROL_FLIPPER_LEFT);
+		input_map.Bind('.', CONTROL_FLIPPER_RIGHT);
+		input_map.Bind('P', CONTROL_PLUNGER);
+		input_map.Bind(' ', CONTROL_NUDGE);
+		input_map.Bind('B', CONTROL_SPAWN_BALL);
+
+		input_map.Bind('W', CONTROL_CAMERA_FORWARD);
+		input_map.Bind('S', CONTROL_CAMERA_BACKWARD);
+		input_map.Bind('A', CONTROL_CAMERA_LEFT);
+		input_map.Bind('D', CONTROL_CAMERA_RIGHT);
+		input_map.Bind('Q', CONTROL_CAMERA_UP);
+		input_map.Bind('Z', CONTROL_CAMERA_DOWN);
+
+		input_map.Bind('I', CONTROL_FORCE_FORWARD);
+		input_map.Bind('K', CONTROL_FORCE_BACKWARD);
+		input_map.Bind('J', CONTROL_FORCE_LEFT);
+		input_map.Bind('L', CONTROL_FORCE_RIGHT);
+		input_map.Bind('U', CONTROL_FORCE_UP);
+		input_map.Bind('M', CONTROL_FORCE_DOWN);
+	}
+
 	void HUDInit()
 	{
 		hud.AddLine(EMPTY, "");
@@ -62,6 +99,11 @@ namespace VisualDebugger
 	{
 		KeyHold();
 
+		// In low latency mode the scene is stepped with the latest input before it is drawn rather than after, so that a
+		// frame already shows the input received while the previous frame was on screen.
+		if (low_latency)
+			StepScene();
+
 		Renderer::Start(camera->getEye(), camera->getDir());
 
 		if ((render_mode == DEBUG) || (render_mode == BOTH))
@@ -69,7 +111,12 @@ namespace VisualDebugger
 
 		if ((render_mode == NORMAL) || (render_mode == BOTH))
 		{
+			// Late-latched flippers are left out here and drawn as the very last thing before the frame is finished.
 			std::vector<PxActor*> actors = scene->GetAllActors();
+			if (low_latency)
+				actors.erase(std::remove_if(actors.begin(), actors.end(), [](PxActor* actor) {
+					return actor == scene->flipperL->Body() || actor == scene->flipperR->Body(); }), actors.end());
+
 			if (actors.size())
 				Renderer::Render(&actors[0], (PxU32)actors.size());
 		}
@@ -85,50 +132,152 @@ namespace VisualDebugger
 
 		hud.Render();
 
+		if (low_latency && ((render_mode == NORMAL) || (render_mode == BOTH)))
+			LateLatch();
+
+		Stopwatch swap;
 		Renderer::Finish();
+		swap_time = swap.Elapsed();
+
+		if (latency)
+			latency->Presented();
+
+		if (!low_latency)
+			StepScene();
+	}
+
+	void StepScene()
+	{
+		DeliverInput();
+
+		// The autopilot's input goes through the same path as the keyboard's, so it is recorded and sent to remote play.
+		if (autopilot && !scene->Pause())
+		{
+			InputAction actions[Autopilot::MAX_ACTIONS];
+			PxU32 count = autopilot->Decide(delta_time, actions);
+			for (PxU32 i = 0; i < count; i++)
+				Input(actions[i]);
+		}
+
+		if (rollback)
+		{
+			// Remote play, deliver whatever input has arrived (usually a few steps late) and let the rollback step
+			// the scene, resimulating from the step each input was sent at.
+			received.clear();
+			loopback->Receive(scene->StepCount(), received);
+			for (unsigned int i = 0; i < received.size(); i++)
+				rollback->Input(received[i].step, received[i].action, received[i].phase);
+
+			rollback->Step(delta_time);
+		}
+		else scene->Update(delta_time);
+
+		stepped_time = Stopwatch::Microseconds();
+	}
+
+	PxTransform Extrapolate(PxRigidDynamic* body, PxReal dt)
+	{
+		// Advance a body's pose by its velocities, turning about its centre of mass as the simulation does.
+		PxTransform pose = body->getGlobalPose();
+		PxVec3 centre = body->getCMassLocalPose().p;
+		PxVec3 w = body->getAngularVelocity();
+		PxReal angle = w.magnitude() * dt;
+
+		PxQuat q = (angle > 1e-6f) ? (PxQuat(angle, w.getNormalized()) * pose.q).getNormalized() : pose.q;
+		PxVec3 p = pose.transform(centre) + body->getLinearVelocity() * dt;
+		return PxTransform(p - q.rotate(centre), q);
+	}
+
+	void LateLatch()
+	{
+		// Draw the flippers at the pose they will have reached when this frame is expected on screen: the time since the
+		// step finished plus what the last swap took. This is capped at a step, so a flipper about to hit its limit
+		// overshoots by at most one step of motion.
+		PxReal lead = (PxReal)((Stopwatch::Microseconds() - stepped_time) / 1e6 + swap_time / 1000.0);
+		lead = scene->Pause() ? 0.f : PxMin(lead, delta_time);
+
+		PxRigidDynamic* flippers[2] = { scene->flipperL->Body(), scene->flipperR->Body() };
+		for (int i = 0; i < 2; i++)
+			Renderer::Render(flippers[i], Extrapolate(flippers[i], lead));
+	}
 
-		scene->Update(delta_time);
+	void Input(InputAction action, PxU8 phase, PxU64 timestamp)
+	{
+		// In remote play input takes the round trip through the loopback channel, otherwise it is applied next step.
+		// Latency is only measured locally, as remote input is delayed on purpose.
+		if (loopback)
+			loopback->Send(scene->StepCount(), action, phase);
+		else
+		{
+			scene->Queue(action, phase, timestamp);
+			if (latency)
+				latency->Delivered(timestamp);
+		}
 	}
 
-	void CameraInput(int key)
+	void DeliverInput()
 	{
-		switch (toupper(key))
+		// Spread the key events since the last step across the next step by when they happened, so that each is applied
+		// at the substep it falls in and a quick tap is no longer cancelled out by its release within the same substep.
+		// In low latency mode everything is applied straight away, before the first substep.
+		PxU64 now = Stopwatch::Microseconds();
+		PxU64 span = (last_step_time && now > last_step_time) ? now - last_step_time : 1;
+
+		InputMap::Event e;
+		while (input_map.Pop(e))
 		{
-			case 'W': camera->MoveForward(delta_time);
+			InputAction action;
+			if (!InputMap::Action(e.control, e.pressed, action))
+				continue;
+
+			PxU64 offset = (e.timestamp > last_step_time) ? e.timestamp - last_step_time : 0;
+			Input(action, low_latency ? 0 : (PxU8)PxMin(offset * 256 / span, (PxU64)255), e.timestamp);
+		}
+
+		last_step_time = now;
+	}
+
+	void CameraInput(InputControl control)
+	{
+		switch (control)
+		{
+			case CONTROL_CAMERA_FORWARD: camera->MoveForward(delta_time);
 				break;
-			case 'S': camera->MoveBackward(delta_time);
+			case CONTROL_CAMERA_BACKWARD: camera->MoveBackward(delta_time);
 				break;
-			case 'A': camera->MoveLeft(delta_time);
+			case CONTROL_CAMERA_LEFT: camera->MoveLeft(delta_time);
 				break;
-			case 'D': camera->MoveRight(delta_time);
+			case CONTROL_CAMERA_RIGHT: camera->MoveRight(delta_time);
 				break;
-			case 'Q': camera->MoveUp(delta_time);
+			case CONTROL_CAMERA_UP: camera->MoveUp(delta_time);
 				break;
-			case 'Z': camera->MoveDown(delta_time);
+			case CONTROL_CAMERA_DOWN: camera->MoveDown(delta_time);
 				break;
 			default:
 				break;
 		}
 	}
 
-	void ForceInput(int key)
+	void ForceInput(InputControl control)
 	{
-		if (!scene->GetSelectedActor())
+		// Forces on the selected actor are not gameplay input and are never recorded or sent to remote play, so they are
+		// disabled whenever they would make a recording or the rollback's resimulation diverge.
+		if (!scene->GetSelectedActor() || recording || rollback)
 			return;
 
-		switch (toupper(key))
+		switch (control)
 		{
-			case 'I': scene->GetSelectedActor()->addForce(PxVec3(0,0,-1)*gForceStrength);
+			case CONTROL_FORCE_FORWARD: scene->GetSelectedActor()->addForce(PxVec3(0,0,-1)*gForceStrength);
 				break;
-			case 'K': scene->GetSelectedActor()->addForce(PxVec3(0,0,1)*gForceStrength);
+			case CONTROL_FORCE_BACKWARD: scene->GetSelectedActor()->addForce(PxVec3(0,0,1)*gForceStrength);
 				break;
-			case 'J': scene->GetSelectedActor()->addForce(PxVec3(-1,0,0)*gForceStrength);
+			case CONTROL_FORCE_LEFT: scene->GetSelectedActor()->addForce(PxVec3(-1,0,0)*gForceStrength);
 				break;
-			case 'L': scene->GetSelectedActor()->addForce(PxVec3(1,0,0)*gForceStrength);
+			case CONTROL_FORCE_RIGHT: scene->GetSelectedActor()->addForce(PxVec3(1,0,0)*gForceStrength);
 				break;
-			case 'U': scene->GetSelectedActor()->addForce(PxVec3(0,1,0)*gForceStrength);
+			case CONTROL_FORCE_UP: scene->GetSelectedActor()->addForce(PxVec3(0,1,0)*gForceStrength);
 				break;
-			case 'M': scene->GetSelectedActor()->addForce(PxVec3(0,-1,0)*gForceStrength);
+			case CONTROL_FORCE_DOWN: scene->GetSelectedActor()->addForce(PxVec3(0,-1,0)*gForceStrength);
 				break;
 			default:
 				break;
@@ -137,38 +286,25 @@ namespace VisualDebugger
 
 	void KeyPress(unsigned char key, int x, int y)
 	{
-		if (key_state[key] == true)
-			return;
-
-		key_state[key] = true;
-
 		if (key == 27)
 			exit(0);
 
-		switch (toupper(key))
-		{
-			case ',': scene->flipperL->InvertDrive();
-				break;
-			case '.': scene->flipperR->InvertDrive();
-				break;
-			default:
-				break;
-		}
+		// Keys only become timestamped control events here. Gameplay actions are delivered to the scene when it next steps,
+		// see DeliverInput, and held controls are applied every frame by KeyHold.
+		input_map.Key(key, true);
 	}
 
 	void KeyHold()
 	{
-		for (int i = 0; i < MAX_KEYS; i++)
+		// Only the controls which are held are visited, lowest bit first.
+		for (PxU32 held = input_map.Held(), control = 0; held; held >>= 1, control++)
 		{
-			if (key_state[i])
+			if (held & 1)
 			{
-				CameraInput(i);
-				ForceInput(i);
+				CameraInput((InputControl)control);
+				ForceInput((InputControl)control);
 			}
 		}
-
-		if (key_state[int('p')])
-			scene->plunger->Pull();
 	}
 
 	void KeySpecial(int key, int x, int y)
@@ -193,8 +329,33 @@ namespace VisualDebugger
 				break;
 			case GLUT_KEY_F10: scene->Pause(!scene->Pause());
 				break;
-			case GLUT_KEY_F12: scene->Reset();
+			case GLUT_KEY_F11: AutoPilot(!autopilot);
+				break;
+			case GLUT_KEY_F12:
+			{
+				// A recording only covers a single game, so finish it before the scene is rebuilt and start the next one
+				// afterwards, from a fresh game as a replay does.
+				bool recording_game = (recording != nullptr);
+				SaveRecording();
+				if (latency)
+					latency->Clear();
+				scene->Reset();
+				Renderer::ReleaseMeshCache();
+
+				if (recording_game)
+				{
+					Game::Instance().Reset(false);
+					Record(recording_path);
+				}
+
+				// Snapshots refer to the actors which were just released, and input in flight belongs to the last game.
+				if (rollback)
+				{
+					rollback->Reset();
+					loopback->Clear();
+				}
 				break;
+			}
 			default:
 				break;
 		}
@@ -202,19 +363,7 @@ namespace VisualDebugger
 
 	void KeyRelease(unsigned char key, int x, int y)
 	{
-		key_state[key] = false;
-
-		switch (toupper(key))
-		{
-			case ',': scene->flipperL->InvertDrive();
-				break;
-			case '.': scene->flipperR->InvertDrive();
-				break;
-			case 'P': scene->plunger->Release();
-				break;
-			default:
-				break;
-		}
+		input_map.Key(key, false);
 	}
 
 	int mMouseX = 0;
@@ -238,11 +387,136 @@ namespace VisualDebugger
 
 	void exitCallback(void)
 	{
+		SaveRecording();
+
+		std::cout << "Simulated " << scene->StepCount() << " steps in " << scene->SimulateCount() << " simulate calls (" << scene->SubsteppedCount()
+			<< " substepped, " << scene->SimulateTime().Average() << "ms average)." << std::endl;
+		std::cout << "Awake bodies: " << scene->AwakeAverage() << " per step on average, " << scene->Callback()->wakeCount << " woken, "
+			<< scene->Callback()->sleepCount << " fell asleep." << std::endl;
+
+		if (telemetry)
+		{
+			telemetry->Close();
+			std::cout << "Telemetry saved (" << telemetry->Records() << " records, " << telemetry->Dropped() << " dropped)." << std::endl;
+			Game::Instance().telemetry(nullptr);
+			delete telemetry;
+		}
+
+		if (rollback)
+		{
+			std::cout << "Remote play: " << rollback->Rollbacks() << " rollbacks, " << rollback->Resimulated() << " steps resimulated ("
+				<< rollback->resimulateTime.Average() << "ms average, " << rollback->resimulateTime.Max() << "ms worst)." << std::endl;
+			delete rollback;
+			delete loopback;
+		}
+
+		if (latency)
+		{
+			std::cout << "Input latency" << (low_latency ? " (low latency mode):" : ":") << std::endl;
+			latency->Print(std::cout);
+			scene->latency = nullptr;
+			delete latency;
+		}
+
 		delete camera;
 		delete scene;
 		PhysicsEngine::PxRelease();
 	}
 
+	void Record(const std::string& path)
+	{
+		// Record every input applied to the scene from the first step, to be saved on exit or when the scene is reset.
+		recording_path = path;
+		recording_games++;
+		recording = new Recording(delta_time, scene->MultiballCapacity(), Game::Instance().rules().Hash());
+		scene->recording = recording;
+	}
+
+	std::string RecordingPath()
+	{
+		// The first game is saved to the path given, later ones have their number added before the extension, e.g.
+		// "game.rec", "game.2.rec", "game.3.rec".
+		if (recording_games <= 1)
+			return recording_path;
+
+		size_t dot = recording_path.find_last_of('.');
+		size_t slash = recording_path.find_last_of("/\\");
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			dot = recording_path.size();
+		return recording_path.substr(0, dot) + "." + std::to_string(recording_games) + recording_path.substr(dot);
+	}
+
+	void StreamTelemetry(const std::string& path)
+	{
+		// Stream the state of every ball after each step, one slot for the player's ball and one per pooled ball. Telemetry
+		// counts the contacts each ball is touching, which needs lost contacts, so the scene is rebuilt with full reporting.
+		scene->Reporting(ContactReporting(ContactReporting::FULL));
+		scene->Reset();
+		Renderer::ReleaseMeshCache();
+
+		telemetry = new Telemetry::Writer(path, scene->WorldBounds(), scene->MultiballCapacity() + 1);
+		scene->telemetry = telemetry;
+		Game::Instance().telemetry(telemetry);
+	}
+
+	void RemotePlay(PxU32 latency, PxU32 jitter)
+	{
+		// Recordings assume that input is applied once and in step order, which rolling back does not guarantee.
+		if (recording)
+		{
+			std::cerr << "Recording is not supported during remote play and has been disabled." << std::endl;
+			scene->recording = nullptr;
+			delete recording;
+			recording = nullptr;
+		}
+
+		// Keep enough snapshots to cover the worst case delay, with some to spare.
+		loopback = new LoopbackChannel(latency, jitter);
+		rollback = new Rollback(scene, PxMax(16u, latency + jitter + 2));
+	}
+
+	void AutoPilot(bool enabled)
+	{
+		// The autopilot assumes both flippers are down when it takes over, so hand over with neither key held.
+		if (enabled && !autopilot)
+			autopilot = new Autopilot(scene);
+		else if (!enabled && autopilot)
+		{
+			std::cout << "Autopilot played " << autopilot->stats().games << " games (" << std::fixed << std::setprecision(1)
+				<< autopilot->stats().GamesPerHour(delta_time) << " per hour)." << std::endl;
+			delete autopilot;
+			autopilot = nullptr;
+		}
+	}
+
+	void MeasureLatency()
+	{
+		// Follow every flipper key press through to the screen, the histograms are printed on exit.
+		if (!latency)
+			latency = new InputLatency();
+		scene->latency = latency;
+	}
+
+	void LowLatency(bool enabled)
+	{
+		low_latency = enabled;
+	}
+
+	void SaveRecording()
+	{
+		if (!recording)
+			return;
+
+		recording->Finish(scene->StepCount(), Game::Instance().score(), scene->StateHash());
+		std::string path = RecordingPath();
+		if (recording->Save(path))
+			std::cout << "Recording saved to " << path << " (" << recording->events().size() << " inputs, " << scene->StepCount() << " steps)." << std::endl;
+
+		scene->recording = nullptr;
+		delete recording;
+		recording = nullptr;
+	}
+
 	void ToggleRenderMode()
 	{
 		if (render_mode == NORMAL)
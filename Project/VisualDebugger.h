@@ -2,11 +2,14 @@
 #define visualdebugger_h
 
 #include <vector>
+#include <algorithm>
 #include <fstream>
 #include "MyPhysicsEngine.h"
-#include "Extras\Camera.h"
-#include "Extras\Renderer.h"
-#include "Extras\HUD.h"
+#include "Rollback.h"
+#include "Autopilot.h"
+#include "Extras/Camera.h"
+#include "Extras/Renderer.h"
+#include "Extras/HUD.h"
 
 namespace VisualDebugger
 {
@@ -20,10 +23,16 @@ namespace VisualDebugger
 	};
 
 	void Init(const char *window_name, int width=512, int height=512);
+	void BindKeys();
 	void HUDInit();
 
 	void Start();
 	void RenderScene();
+	void StepScene();
+	void LateLatch();
+
+	void Input(InputAction action, PxU8 phase = 0, PxU64 timestamp = 0);
+	void DeliverInput();
 
 	void KeyPress(unsigned char key, int x, int y);
 	void KeyHold();
@@ -34,6 +43,15 @@ namespace VisualDebugger
 	void mouseCallback(int button, int state, int x, int y);
 	void exitCallback(void);
 
+	void Record(const std::string& path);
+	void StreamTelemetry(const std::string& path);
+	void RemotePlay(PxU32 latency, PxU32 jitter = 0);
+	void AutoPilot(bool enabled);
+	void MeasureLatency();
+	void LowLatency(bool enabled);
+	std::string RecordingPath();
+	void SaveRecording();
+
 	void ToggleRenderMode();
 
 	void AddHUD(int screen_id, std::string directory, bool smartScreen = false);